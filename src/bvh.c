@@ -0,0 +1,352 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include "bvh.h"
+
+#define STACK_SIZE 256 /* ample for two trees of depth <= 31 each */
+
+/* state for bvh_min_distance */
+struct min_dist_ctx
+{
+	double best2;
+};
+
+/* state for bvh_count_contacts */
+struct contact_ctx
+{
+	double cutoff2;
+	float cutoff2f;
+	bool self;
+	long count;
+};
+
+/* PRIVATE FUNCTIONS */
+static void __build(SegBvh *bvh, int index, int first, int count);
+static bool __min_dist_test(const BvhNode *a, const BvhNode *b, void *ctx);
+static int __min_dist_leaf(const SegBvh *a, const BvhNode *leaf_a,
+	const SegBvh *b, const BvhNode *leaf_b, void *ctx);
+static bool __contact_test(const BvhNode *a, const BvhNode *b, void *ctx);
+static int __contact_leaf(const SegBvh *a, const BvhNode *leaf_a,
+	const SegBvh *b, const BvhNode *leaf_b, void *ctx);
+static inline bool __adjacent(const SegBvh *bvh, int i, int j);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int bvh_build(SegBvh *bvh, const Point3D pts[], int N, bool closed)
+{
+	bvh->pts = pts;
+	bvh->N = N;
+	bvh->num_segments = N < 2 ? 0 : (closed ? N : N - 1);
+	bvh->num_nodes = 0;
+	// halving leaves every leaf over half full, so there are fewer than
+	// 2 * ceil(segments / leaf size) leaves and twice that many nodes
+	int max_nodes = 4 * ((bvh->num_segments + BVH_LEAF_SIZE - 1) / BVH_LEAF_SIZE) + 1;
+	bvh->nodes = (BvhNode *)malloc(max_nodes * sizeof(BvhNode));
+	if (bvh->nodes == NULL) return BVH_MALLOC_ERROR;
+	if (bvh->num_segments > 0)
+	{
+		bvh->num_nodes = 1;
+		__build(bvh, 0, 0, bvh->num_segments);
+	}
+	return BVH_TRUE;
+}
+
+void bvh_destroy(SegBvh *bvh)
+{
+	free(bvh->nodes);
+	bvh->nodes = NULL;
+	bvh->num_nodes = 0;
+}
+
+int bvh_dual_traverse(const SegBvh *a, const SegBvh *b, bvh_node_test test,
+	bvh_leaf_fn leaf, void *ctx)
+{
+	if (a->num_nodes == 0 || b->num_nodes == 0) return BVH_TRUE;
+
+	int stack[STACK_SIZE][2];
+	int top = 0;
+	stack[top][0] = 0;
+	stack[top][1] = 0;
+	top++;
+	while (top > 0)
+	{
+		top--;
+		const BvhNode *na = &a->nodes[stack[top][0]];
+		const BvhNode *nb = &b->nodes[stack[top][1]];
+		if (!test(na, nb, ctx)) continue;
+		if (na->left < 0 && nb->left < 0)
+		{
+			int status = leaf(a, na, b, nb, ctx);
+			if (status != BVH_TRUE) return status;
+			continue;
+		}
+
+		// split the larger node; push the farther child pair first so the
+		// nearer one is visited first
+		int ia = stack[top][0], ib = stack[top][1];
+		int pair[2][2];
+		if (nb->left < 0 || (na->left >= 0 && na->count >= nb->count))
+		{
+			pair[0][0] = na->left;
+			pair[1][0] = na->left + 1;
+			pair[0][1] = pair[1][1] = ib;
+		}
+		else
+		{
+			pair[0][0] = pair[1][0] = ia;
+			pair[0][1] = nb->left;
+			pair[1][1] = nb->left + 1;
+		}
+		float d0 = bvh_box_dist2(&a->nodes[pair[0][0]], &b->nodes[pair[0][1]]);
+		float d1 = bvh_box_dist2(&a->nodes[pair[1][0]], &b->nodes[pair[1][1]]);
+		int near = d1 < d0 ? 1 : 0;
+		stack[top][0] = pair[1 - near][0];
+		stack[top][1] = pair[1 - near][1];
+		stack[top + 1][0] = pair[near][0];
+		stack[top + 1][1] = pair[near][1];
+		top += 2;
+	}
+	return BVH_TRUE;
+}
+
+int bvh_query(const SegBvh *bvh, const float lo[3], const float hi[3],
+	int (*visit)(int seg, void *ctx), void *ctx)
+{
+	if (bvh->num_nodes == 0) return BVH_TRUE;
+
+	int stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const BvhNode *node = &bvh->nodes[stack[--top]];
+		// one branch per node instead of six
+		bool overlap = (node->lo[0] <= hi[0]) & (lo[0] <= node->hi[0])
+			& (node->lo[1] <= hi[1]) & (lo[1] <= node->hi[1])
+			& (node->lo[2] <= hi[2]) & (lo[2] <= node->hi[2]);
+		if (!overlap) continue;
+		if (node->left >= 0)
+		{
+			stack[top++] = node->left + 1;
+			stack[top++] = node->left;
+			continue;
+		}
+		for (int i = node->first; i < node->first + node->count; i++)
+		{
+			int status = visit(i, ctx);
+			if (status != BVH_TRUE) return status;
+		}
+	}
+	return BVH_TRUE;
+}
+
+void bvh_expand(SegBvh *bvh, int seg, const Point3D *pt)
+{
+	if (bvh->num_nodes == 0) return;
+	float c[3] = {pt->x, pt->y, pt->z};
+	int index = 0;
+	for (;;)
+	{
+		BvhNode *node = &bvh->nodes[index];
+		for (int k = 0; k < 3; k++)
+		{
+			if (c[k] < node->lo[k]) node->lo[k] = c[k];
+			if (c[k] > node->hi[k]) node->hi[k] = c[k];
+		}
+		if (node->left < 0) return;
+		const BvhNode *left = &bvh->nodes[node->left];
+		index = seg < left->first + left->count ? node->left : node->left + 1;
+	}
+}
+
+double seg_seg_dist2(const Point3D *p0, const Point3D *p1,
+	const Point3D *q0, const Point3D *q1)
+{
+	// closest points of two segments, after Ericson, Real-Time Collision
+	// Detection, section 5.1.9
+	double d1[3] = {p1->x - p0->x, p1->y - p0->y, p1->z - p0->z};
+	double d2[3] = {q1->x - q0->x, q1->y - q0->y, q1->z - q0->z};
+	double r[3] = {p0->x - q0->x, p0->y - q0->y, p0->z - q0->z};
+	double a = d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2];
+	double e = d2[0] * d2[0] + d2[1] * d2[1] + d2[2] * d2[2];
+	double f = d2[0] * r[0] + d2[1] * r[1] + d2[2] * r[2];
+	double s, t;
+	if (a <= DBL_EPSILON && e <= DBL_EPSILON)
+	{
+		s = t = 0.0;
+	}
+	else if (a <= DBL_EPSILON)
+	{
+		s = 0.0;
+		t = f / e;
+		t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+	}
+	else
+	{
+		double c = d1[0] * r[0] + d1[1] * r[1] + d1[2] * r[2];
+		if (e <= DBL_EPSILON)
+		{
+			t = 0.0;
+			s = -c / a;
+			s = s < 0.0 ? 0.0 : s > 1.0 ? 1.0 : s;
+		}
+		else
+		{
+			double b = d1[0] * d2[0] + d1[1] * d2[1] + d1[2] * d2[2];
+			double denom = a * e - b * b;
+			s = denom > 0.0 ? (b * f - c * e) / denom : 0.0;
+			s = s < 0.0 ? 0.0 : s > 1.0 ? 1.0 : s;
+			t = (b * s + f) / e;
+			if (t < 0.0)
+			{
+				t = 0.0;
+				s = -c / a;
+				s = s < 0.0 ? 0.0 : s > 1.0 ? 1.0 : s;
+			}
+			else if (t > 1.0)
+			{
+				t = 1.0;
+				s = (b - c) / a;
+				s = s < 0.0 ? 0.0 : s > 1.0 ? 1.0 : s;
+			}
+		}
+	}
+	double dist2 = 0.0;
+	for (int k = 0; k < 3; k++)
+	{
+		double gap = r[k] + d1[k] * s - d2[k] * t;
+		dist2 += gap * gap;
+	}
+	return dist2;
+}
+
+double bvh_min_distance(const SegBvh *a, const SegBvh *b)
+{
+	struct min_dist_ctx ctx = {DBL_MAX};
+	bvh_dual_traverse(a, b, __min_dist_test, __min_dist_leaf, &ctx);
+	return ctx.best2 == DBL_MAX ? DBL_MAX : sqrt(ctx.best2);
+}
+
+long bvh_count_contacts(const SegBvh *a, const SegBvh *b, double cutoff)
+{
+	struct contact_ctx ctx = {
+		.cutoff2  = cutoff * cutoff,
+		.cutoff2f = (float)(cutoff * cutoff) * (1.0f + 4.0f * FLT_EPSILON),
+		.self     = a == b,
+		.count    = 0
+	};
+	bvh_dual_traverse(a, b, __contact_test, __contact_leaf, &ctx);
+	return ctx.count;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+/* Fill nodes[index] with the subtree of segments first .. first + count - 1 */
+static void __build(SegBvh *bvh, int index, int first, int count)
+{
+	BvhNode *node = &bvh->nodes[index];
+	node->first = first;
+	node->count = count;
+	if (count <= BVH_LEAF_SIZE)
+	{
+		node->left = -1;
+		const Point3D *p = &bvh->pts[first];
+		float lo[3] = {p->x, p->y, p->z}, hi[3] = {p->x, p->y, p->z};
+		for (int i = first; i < first + count; i++)
+		{
+			// the start of each segment plus the end of the last one
+			const Point3D *p0, *p1;
+			bvh_segment(bvh, i, &p0, &p1);
+			float c[3] = {p1->x, p1->y, p1->z};
+			for (int k = 0; k < 3; k++)
+			{
+				if (c[k] < lo[k]) lo[k] = c[k];
+				if (c[k] > hi[k]) hi[k] = c[k];
+			}
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			node->lo[k] = lo[k];
+			node->hi[k] = hi[k];
+		}
+		return;
+	}
+
+	// siblings are allocated together so the right child is always left + 1
+	int left = bvh->num_nodes;
+	bvh->num_nodes += 2;
+	int half = count / 2;
+	__build(bvh, left, first, half);
+	__build(bvh, left + 1, first + half, count - half);
+	node->left = left;
+	const BvhNode *l = &bvh->nodes[left], *r = &bvh->nodes[left + 1];
+	for (int k = 0; k < 3; k++)
+	{
+		node->lo[k] = l->lo[k] < r->lo[k] ? l->lo[k] : r->lo[k];
+		node->hi[k] = l->hi[k] > r->hi[k] ? l->hi[k] : r->hi[k];
+	}
+}
+
+static bool __min_dist_test(const BvhNode *a, const BvhNode *b, void *ctx)
+{
+	return bvh_box_dist2(a, b) < ((struct min_dist_ctx *)ctx)->best2;
+}
+
+static int __min_dist_leaf(const SegBvh *a, const BvhNode *leaf_a,
+	const SegBvh *b, const BvhNode *leaf_b, void *ctx)
+{
+	struct min_dist_ctx *md = (struct min_dist_ctx *)ctx;
+	for (int i = leaf_a->first; i < leaf_a->first + leaf_a->count; i++)
+	{
+		const Point3D *p0, *p1;
+		bvh_segment(a, i, &p0, &p1);
+		for (int j = leaf_b->first; j < leaf_b->first + leaf_b->count; j++)
+		{
+			const Point3D *q0, *q1;
+			bvh_segment(b, j, &q0, &q1);
+			double dist2 = seg_seg_dist2(p0, p1, q0, q1);
+			if (dist2 < md->best2) md->best2 = dist2;
+		}
+	}
+	return BVH_TRUE;
+}
+
+static bool __contact_test(const BvhNode *a, const BvhNode *b, void *ctx)
+{
+	struct contact_ctx *cc = (struct contact_ctx *)ctx;
+	// a self traversal meets every pair of leaves twice; keep the one with a
+	// first (the leaf callback also halves a leaf paired with itself)
+	if (cc->self && b->first + b->count <= a->first) return false;
+	return bvh_box_dist2(a, b) <= cc->cutoff2f;
+}
+
+static int __contact_leaf(const SegBvh *a, const BvhNode *leaf_a,
+	const SegBvh *b, const BvhNode *leaf_b, void *ctx)
+{
+	struct contact_ctx *cc = (struct contact_ctx *)ctx;
+	for (int i = leaf_a->first; i < leaf_a->first + leaf_a->count; i++)
+	{
+		const Point3D *p0, *p1;
+		bvh_segment(a, i, &p0, &p1);
+		int j0 = leaf_b->first;
+		if (cc->self && j0 <= i) j0 = i + 1;
+		for (int j = j0; j < leaf_b->first + leaf_b->count; j++)
+		{
+			if (cc->self && __adjacent(a, i, j)) continue;
+			const Point3D *q0, *q1;
+			bvh_segment(b, j, &q0, &q1);
+			if (seg_seg_dist2(p0, p1, q0, q1) <= cc->cutoff2) cc->count++;
+		}
+	}
+	return BVH_TRUE;
+}
+
+/* Whether segments i < j of one chain share a vertex */
+static inline bool __adjacent(const SegBvh *bvh, int i, int j)
+{
+	return j == i + 1 || (bvh->num_segments == bvh->N && i == 0 && j == bvh->N - 1);
+}
@@ -0,0 +1,112 @@
+#ifndef BVH_H_
+#define BVH_H_
+
+#include <stdbool.h>
+#include "point3d.h"
+
+#define BVH_TRUE 0
+#define BVH_MALLOC_ERROR -2
+
+#define BVH_LEAF_SIZE 8 /* segments per leaf */
+
+/*
+ * Bounding-volume hierarchy over the segments of one chain.
+ *
+ * Segment i runs from pts[i] to pts[i + 1] (and, for a closed chain, segment
+ * N - 1 from pts[N - 1] back to pts[0]). Each node boxes a contiguous run of
+ * segments and halves it between its children, so the tree follows the chain
+ * and builds in O(N). nodes[0] is the root and a node's children are
+ * nodes[left] and nodes[left + 1].
+ */
+typedef struct
+{
+	float lo[3];
+	float hi[3];
+	int first;  /* first segment */
+	int count;  /* segments first .. first + count - 1 */
+	int left;   /* first child, or -1 for a leaf */
+} BvhNode, bvh_node;
+
+typedef struct
+{
+	BvhNode *nodes;
+	int num_nodes;
+	const Point3D *pts; /* the chain is referenced, not copied */
+	int N;
+	int num_segments;
+} SegBvh, seg_bvh;
+
+/* Decide whether the segments under a and b may still matter */
+typedef bool (*bvh_node_test)(const BvhNode *a, const BvhNode *b, void *ctx);
+
+/*
+ * Visit a pair of leaves that passed every test on the way down. Returning
+ * anything other than BVH_TRUE stops the traversal and is passed back.
+ */
+typedef int (*bvh_leaf_fn)(const SegBvh *a, const BvhNode *leaf_a,
+	const SegBvh *b, const BvhNode *leaf_b, void *ctx);
+
+/* Build the hierarchy of pts[0 .. N - 1]; the chain must outlive it */
+int bvh_build(SegBvh *bvh, const Point3D pts[], int N, bool closed);
+
+void bvh_destroy(SegBvh *bvh);
+
+static inline void bvh_segment(const SegBvh *bvh, int i, const Point3D **p0,
+	const Point3D **p1)
+{
+	*p0 = &bvh->pts[i];
+	*p1 = &bvh->pts[i + 1 < bvh->N ? i + 1 : 0];
+}
+
+/* Squared distance between two boxes; 0 if they overlap */
+static inline float bvh_box_dist2(const BvhNode *a, const BvhNode *b)
+{
+	float dist2 = 0.0f;
+	for (int k = 0; k < 3; k++)
+	{
+		float gap = a->lo[k] > b->hi[k] ? a->lo[k] - b->hi[k]
+			: b->lo[k] > a->hi[k] ? b->lo[k] - a->hi[k] : 0.0f;
+		dist2 += gap * gap;
+	}
+	return dist2;
+}
+
+/*  Walk both trees together, descending only into node pairs test accepts,
+    nearer pairs first, and hand every surviving leaf pair to leaf. a and b
+    may be the same tree, in which case each unordered pair of distinct
+    leaves is met twice and every leaf once with itself.
+
+    Returns:
+        BVH_TRUE once the traversal is complete
+        otherwise, the first non-BVH_TRUE value leaf returned
+*/
+int bvh_dual_traverse(const SegBvh *a, const SegBvh *b, bvh_node_test test,
+	bvh_leaf_fn leaf, void *ctx);
+
+/*  Call visit on every segment of a leaf whose box meets [lo, hi]. Returning
+    anything other than BVH_TRUE stops the query and is passed back.
+*/
+int bvh_query(const SegBvh *bvh, const float lo[3], const float hi[3],
+	int (*visit)(int seg, void *ctx), void *ctx);
+
+/*
+ * Grow the boxes from the root down to the leaf holding segment seg so they
+ * also contain pt, e.g. after the segment's end moved to pt. The tree stays
+ * conservative for callers that edit the chain in place.
+ */
+void bvh_expand(SegBvh *bvh, int seg, const Point3D *pt);
+
+/* Squared distance between segments p0 -> p1 and q0 -> q1 */
+double seg_seg_dist2(const Point3D *p0, const Point3D *p1,
+	const Point3D *q0, const Point3D *q1);
+
+/* Smallest distance between a segment of a and a segment of b */
+double bvh_min_distance(const SegBvh *a, const SegBvh *b);
+
+/*
+ * Number of segment pairs (one from each tree) at most cutoff apart. With
+ * a == b each unordered pair of non-adjacent segments is counted once.
+ */
+long bvh_count_contacts(const SegBvh *a, const SegBvh *b, double cutoff);
+
+#endif /* BVH_H_ */
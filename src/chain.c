@@ -1,6 +1,6 @@
 #include <stdio.h>
-#include <float.h>
 #include "chain.h"
+#include "rng.h"
 
 
 void generate_random_chain(Point3D chain[], int N, float range_half_len,
@@ -31,76 +31,118 @@ void generate_random_chain(Point3D chain[], int N, float range_half_len,
 }
 
 
-void generate_chain_worm(Point3D chain[], int N, Point3D dirs[], int dirs_len,
-	int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+int generate_chain_worm(Point3D chain[], int N, Point3D dirs[], int dirs_len,
+	int dim, OccBitmap *occ, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
 {
 	Point3D node;
 	Point3D dir;
 	pt_init(&node);
 	pt_init(&dir);
-		
+
+	// the occupancy bitmap persists across attempts: forget the last one
+	occ_bitmap_reset(occ);
+	pt_copy(&node, &chain[0]);
+	if (occ_bitmap_insert(occ, &node) == OCC_MALLOC_ERROR) return OCC_MALLOC_ERROR;
+
+	// every step takes both words of its block, used or not, so step i
+	// always reads block ctr->v[0] + i
+	RngStream rng;
+	rng_init(&rng, *ctr, *key);
+
 	// loop over all possible nodes (first is at origin)
 	for (int i = 1; i < N; i++)
 	{
-		// first, check if we are locked out
-		// create surrounding array
-		Point3D surrounding[dirs_len];
-		chain_init(surrounding, dirs_len);		
-		add_to_all(&node, dirs, dirs_len, surrounding);
-
-		// create set versions of relevant arrays
-		PointSet chain_as_set, surrounding_as_set, remaining_surrounding;
-		set_init(&chain_as_set);
-		set_init(&surrounding_as_set);
-		set_init(&remaining_surrounding);
-		chain_to_set(chain, N, &chain_as_set);
-		chain_to_set(surrounding, dirs_len, &surrounding_as_set);
-		// check to see if we are locked out
-		if (set_is_subset(&surrounding_as_set, &chain_as_set) == SET_TRUE)
+		uint32_t u_dir = rng_u32(&rng);
+		uint32_t u_free = rng_u32(&rng);
+		ctr->v[0]++;
+
+		// first, check if we are locked out by collecting the free neighbors
+		Point3D free_nbrs[dirs_len];
+		int num_free = 0;
+		for (int j = 0; j < dirs_len; j++)
 		{
-			chain_reset(chain, N);
-		 	return; 
+			Point3D nbr = pt_add(&node, &dirs[j]);
+			if (!occ_bitmap_contains(occ, &nbr)) free_nbrs[num_free++] = nbr;
 		}
+		if (num_free == 0) return OCC_FALSE;
 
 		// if not locked out, choose a neighbor from special pdf
 		float probs[dirs_len];
 		special_prob_dist(probs, N - i, &node, dim, dirs, dirs_len);	
-		dir = chain_rand_choice(dirs, dirs_len, probs, ctr, key);	
+		dir = dirs[chain_pick_dir(probs, dirs_len, u_dir)];
 		Point3D new_node = pt_add(&node, &dir);
 
-		// while we choose an already occupied node, find an unoccupied neighbor
-		if (set_contains(&chain_as_set, &new_node) == SET_TRUE)
+		// if we chose an already occupied node, pick a free neighbor instead
+		if (occ_bitmap_contains(occ, &new_node))
 		{
-			// find the set of all unoccupied neighbors
-			set_difference(&remaining_surrounding, &surrounding_as_set, &chain_as_set);	
-			new_node = set_rand_choice(&remaining_surrounding, ctr, key);	
+			new_node = free_nbrs[((uint64_t)u_free * (uint64_t)num_free) >> 32];
 		}
 		// once we get a unique new node, add it to the chain and set as
 		// current node for next iteration	
 		pt_copy(&new_node, &chain[i]);
 		pt_copy(&new_node, &node);
+		if (occ_bitmap_insert(occ, &node) == OCC_MALLOC_ERROR) return OCC_MALLOC_ERROR;
 	}
+	return OCC_TRUE;
 }
 
 
-void generate_closed_chain(Point3D chain[], int N, Point3D dirs[], int dirs_len,
-	int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+int sample_closed_chain(Point3D chain[], int N, Point3D dirs[], int dirs_len,
+	int dim, OccBitmap *occ, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
 {
 	assert(N > 0);
 	assert(dirs_len > 0); 
 	int attempts = 0;
-	// case work: 1) initialized chain, all zeros,
-	// or 2) we had to give up because we were locked out,
-	// or 3) we generate a chain, but it's not closed
-	while (is_reset(chain, N) || !is_closed(chain, N))
+	threefry2x32_ctr_t first = *ctr;
+	// case work: 1) we had to give up because we were locked out,
+	// or 2) we generate a chain, but it's not closed
+	int generated;
+	do
 	{
-		generate_chain_worm(chain, N, dirs, dirs_len, dim, ctr, key);	
+		ctr->v[0] = first.v[0];
+		ctr->v[1] = first.v[1] + (uint32_t)attempts;
+		generated = generate_chain_worm(chain, N, dirs, dirs_len, dim, occ, ctr, key);
+		if (generated == OCC_MALLOC_ERROR) return OCC_MALLOC_ERROR;
 		attempts++;
+	} while (generated != OCC_TRUE || !is_closed(chain, N));
+	ctr->v[0] = first.v[0];
+	ctr->v[1] = first.v[1] + (uint32_t)attempts;
+	return attempts;
+}
+
+
+void generate_closed_chain(Point3D chain[], int N, Point3D dirs[], int dirs_len,
+	int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	OccBitmap occ;
+	if (occ_bitmap_init(&occ, N) != OCC_TRUE)
+	{
+		fprintf(stderr, "%s() error: could not allocate occupancy bitmap.\n", __func__);
+		exit(1);
+	}
+	int attempts = sample_closed_chain(chain, N, dirs, dirs_len, dim, &occ, ctr, key);
+	occ_bitmap_destroy(&occ);
+	if (attempts == OCC_MALLOC_ERROR)
+	{
+		fprintf(stderr, "%s() error: could not grow occupancy bitmap.\n", __func__);
+		exit(1);
 	}
 	printf("Took %d attempts to generate (%d)-SAW.\n", attempts, N);
 }
 
 
+int generate_closed_chain_buf(ChainBuffer *buf, int N, Point3D dirs[],
+	int dirs_len, int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	if (chain_buf_resize(buf, N) != CHAIN_BUF_TRUE) return CHAIN_BUF_MALLOC_ERROR;
+	OccBitmap occ;
+	if (occ_bitmap_init(&occ, N) != OCC_TRUE) return CHAIN_BUF_MALLOC_ERROR;
+	int attempts = sample_closed_chain(buf->pts, N, dirs, dirs_len, dim, &occ, ctr, key);
+	occ_bitmap_destroy(&occ);
+	return attempts == OCC_MALLOC_ERROR ? CHAIN_BUF_MALLOC_ERROR : attempts;
+}
+
+
 void special_prob_dist(float probs[], int num_left, Point3D *node,
 	int dim, Point3D dirs[], int num_dirs)
 {
@@ -126,27 +168,19 @@ void special_prob_dist(float probs[], int num_left, Point3D *node,
 Point3D chain_rand_choice(Point3D dirs[], int num_dirs, float *probs,
 	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
 {
-	float cum_prob[num_dirs];
-	float accum = 0.0;
-	for (int i = 0; i < num_dirs; i++)
-	{
-		accum += probs[i];
-		cum_prob[i] = accum;
-	}
-	assert(flt_near_eq(accum, 1.0, EPS));
+	return dirs[chain_pick_dir(probs, num_dirs, rand_u32(ctr, key))];
+}
 
-	float rand_val = rand_flt(ctr, key, 0.0, 1.0);
-	Point3D return_val;
-	pt_init(&return_val);
-	for (int i = 0; i < num_dirs; i++)
-	{
-		if (flt_less_than(rand_val, cum_prob[i], EPS))
-		{
-			pt_copy(&(dirs[i]), &return_val);
-			break;
-		}
-	}	
-	return return_val;
+
+int chain_pick_dir(const float probs[], int num_dirs, uint32_t u)
+{
+	// a handful of directions: keep the alias table on the stack
+	float prob[num_dirs];
+	int alias[num_dirs], work[num_dirs];
+	AliasTable table;
+	alias_bind(&table, num_dirs, prob, alias, work);
+	alias_build(&table, probs, num_dirs);
+	return alias_pick(&table, u);
 }
 
 
@@ -161,6 +195,20 @@ void add_to_all(Point3D *to_add, Point3D add_to[],
 }
 
 
+void chain_centre(const Point3D chain[], int N, double com[3])
+{
+	assert(N > 0);
+	com[0] = com[1] = com[2] = 0.0;
+	for (int i = 0; i < N; i++)
+	{
+		com[0] += chain[i].x;
+		com[1] += chain[i].y;
+		com[2] += chain[i].z;
+	}
+	for (int k = 0; k < 3; k++) com[k] /= N;
+}
+
+
 void chain_init(Point3D chain[], int N)
 {
 	assert(N > 0);
@@ -238,7 +286,6 @@ bool is_subset(Point3D compare[], int compare_len,
 /*
  * less_than indicates that we wish to say the chain
  * is unique **up to** element at index less_than.
- * This is done because
  */
 bool is_unique(Point3D chain[], int N, int less_than)
 {
@@ -246,35 +293,33 @@ bool is_unique(Point3D chain[], int N, int less_than)
 	assert(less_than <= N);
 	// only index less than 1 is 0, so must be unique
 	if (less_than == 1) return true;
-	Point3D seen[less_than];
-	for (int i = 0; i < less_than; i++)
+	Occupancy seen;
+	if (occ_init(&seen, less_than) != OCC_TRUE)
 	{
-		// need better initialization values
-		seen[i].x = FLT_MAX;
-		seen[i].y = FLT_MAX;
-		seen[i].z = FLT_MAX;
+		fprintf(stderr, "%s() error: could not allocate occupancy index.\n", __func__);
+		exit(1);
 	}
-	// loop through points beyond the starting index
-	// and check whether we have seen this point before
-	for (int i = 0; i < less_than; i++)
+	// check whether we have seen each point before
+	bool unique = true;
+	for (int i = 0; i < less_than && unique; i++)
 	{
-		printf("testing...\n");
-		if (binary_search(&chain[i], seen, less_than) != -1)
-		{
-			return false;
-		}
-		pt_copy(&chain[i], &seen[i]);
+		unique = occ_insert(&seen, &chain[i], i) == OCC_TRUE;
 	}
-	return true;
+	occ_destroy(&seen);
+	return unique;
 }
 
 
 bool is_closed(Point3D chain[], int N)
 {
 	assert(N > 0);
-	if (is_reset(chain, N)) return false;
-	Point3D difference = pt_subtr(&chain[0], &chain[N - 1]);
-	return (flt_near_eq(pt_norm_sq(&difference), 3.0, EPS)) ? true : false;
+	// closed iff the last monomer is one lattice step from the first
+	// (this also rules out the all-zeros chain)
+	LatticePoint first = lat_from_pt(&chain[0]);
+	LatticePoint last = lat_from_pt(&chain[N - 1]);
+	return abs(first.x - last.x) == 1
+		&& abs(first.y - last.y) == 1
+		&& abs(first.z - last.z) == 1;
 }
 
 
@@ -315,12 +360,11 @@ void gen_all_bin_list3(Point3D bin_list[], int bin_list_len)
 
 void chain_to_str(Point3D chain[], int chain_len, char result[])
 {
+	// track the end of result ourselves instead of strcat-ing from the start
+	char *end = result + strlen(result);
 	for (int i = 0; i < chain_len; i++)
 	{
-		char *node_str = pt_to_str(chain[i]);
-		strcat(result, node_str);
-		strcat(result, "\n");
-		if (node_str) free(node_str);
+		end += sprintf(end, "%.2f, %.2f, %.2f\n", chain[i].x, chain[i].y, chain[i].z);
 	}
 }
 
@@ -328,10 +372,7 @@ void chain_to_str(Point3D chain[], int chain_len, char result[])
 void print_chain(Point3D chain[], int chain_len)
 {
 	assert(chain_len > 0);
-	for (int i = 0; i < chain_len; i++)
-	{
-		print_pt(chain[i]);
-	}
+	chain_fprint(stdout, chain, chain_len);
 }
 
 
@@ -377,10 +418,17 @@ int binary_search(Point3D *node_key, Point3D chain[], int N)
 {
 	if (!is_sorted(chain, N))
 	{
-		Point3D chain_cp[N];
+		Point3D *chain_cp = (Point3D *)malloc(N * sizeof(Point3D));
+		if (chain_cp == NULL)
+		{
+			fprintf(stderr, "%s() error: could not copy chain.\n", __func__);
+			exit(1);
+		}
 		chain_copy(chain, N, chain_cp);
 		sort(chain_cp, N);
-		return binary_search_helper(node_key, chain_cp, 0, N - 1);	
+		int index = binary_search_helper(node_key, chain_cp, 0, N - 1);
+		free(chain_cp);
+		return index;
 	}
 	return binary_search_helper(node_key, chain, 0, N - 1);	
 }
@@ -401,4 +449,3 @@ int binary_search_helper(Point3D *node_key, Point3D chain[],
 		return binary_search_helper(node_key, chain, mid + 1, p_1);
 	}
 }
-
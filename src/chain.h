@@ -6,10 +6,13 @@
 #include "numerics.h"
 #include "set.h"
 #include "point3d.h"
+#include "occupancy.h"
+#include "occ_bitmap.h"
+#include "lattice.h"
+#include "sampler.h"
+#include "chain_buffer.h"
 
 
-#define MAX_CHAIN_LEN 200
-#define MAX_CHAIN_STR_LEN 22400 // MAX_CHAIN_LEN * MAX_PT_STR_LEN 
 #define EPS 1e-6f
 
 
@@ -17,14 +20,43 @@ void generate_random_chain(Point3D chain[], int N, float range_half_len,
 	bool restrict_lattice, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
 
 
-void generate_chain_worm(Point3D chain[], int N, Point3D dirs[], int dirs_len,
-	int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+/*
+ * Grow one walk of N monomers from the origin, recording visited sites in occ
+ * (reset on entry). Step i draws the two words of block ctr->v[0] + i, and
+ * only those, so monomer i depends on the stream and i alone and not on what
+ * earlier steps drew. ctr->v[0] is left at the last block used and ctr->v[1]
+ * is untouched. Returns OCC_TRUE if the walk was grown, OCC_FALSE if it got
+ * locked out, or OCC_MALLOC_ERROR if occ could not grow.
+ */
+int generate_chain_worm(Point3D chain[], int N, Point3D dirs[], int dirs_len,
+	int dim, OccBitmap *occ, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+
+/*
+ * Retry generate_chain_worm until it yields a closed walk, reusing occ for
+ * every attempt. Attempt a runs on counters {ctr->v[0], ctr->v[1] + a} as
+ * given on entry, so any attempt can be replayed on its own; on return
+ * ctr->v[1] is past the last attempt, so reusing ctr gives a fresh chain.
+ * Returns the number of attempts taken, or OCC_MALLOC_ERROR if occ could not
+ * grow; prints nothing.
+ */
+int sample_closed_chain(Point3D chain[], int N, Point3D dirs[], int dirs_len,
+	int dim, OccBitmap *occ, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
 
 
 void generate_closed_chain(Point3D chain[], int N, Point3D dirs[], int dirs_len,
 	int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
 
 
+/*
+ * generate_closed_chain into a heap buffer resized to N monomers, for chains
+ * too long for the stack. Returns the number of attempts, or
+ * CHAIN_BUF_MALLOC_ERROR.
+ */
+int generate_closed_chain_buf(ChainBuffer *buf, int N, Point3D dirs[],
+	int dirs_len, int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+
 void special_prob_dist(float probs[], int num_left, Point3D *node,
 	int dim, Point3D dirs[], int num_dirs);
 
@@ -33,10 +65,18 @@ Point3D chain_rand_choice(Point3D dirs[], int num_dirs, float *probs,
 	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
 
 
+/* Index of the direction probs gives for the random word u, as the worm picks it */
+int chain_pick_dir(const float probs[], int num_dirs, uint32_t u);
+
+
 void add_to_all(Point3D *to_add, Point3D add_to[],
 	int add_to_len, Point3D result[]);
 
 
+/* Centre of mass of chain[0 .. N - 1], in double for long chains */
+void chain_centre(const Point3D chain[], int N, double com[3]);
+
+
 void chain_init(Point3D chain[], int N);
 
 
@@ -69,6 +109,10 @@ bool is_sorted(Point3D chain[], int N);
 void gen_all_bin_list3(Point3D bin_list[], int bin_list_len);
 
 
+/*
+ * Append one line per monomer to result, which must have room for it; prefer
+ * chain_fprint / chain_emit for long chains.
+ */
 void chain_to_str(Point3D chain[], int chain_len, char result[]);
 
 
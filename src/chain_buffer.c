@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include "chain_buffer.h"
+
+#define MIN_CAPACITY 64
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int chain_buf_init(ChainBuffer *buf, size_t capacity)
+{
+	buf->pts = NULL;
+	buf->len = 0;
+	buf->capacity = 0;
+	return chain_buf_reserve(buf, capacity);
+}
+
+void chain_buf_destroy(ChainBuffer *buf)
+{
+	free(buf->pts);
+	buf->pts = NULL;
+	buf->len = 0;
+	buf->capacity = 0;
+}
+
+int chain_buf_reserve(ChainBuffer *buf, size_t capacity)
+{
+	if (capacity <= buf->capacity) return CHAIN_BUF_TRUE;
+	// grow geometrically so repeated pushes stay amortized O(1)
+	size_t new_capacity = buf->capacity ? buf->capacity : MIN_CAPACITY;
+	while (new_capacity < capacity) new_capacity *= 2;
+	Point3D *pts = (Point3D *)realloc(buf->pts, new_capacity * sizeof(Point3D));
+	if (pts == NULL) return CHAIN_BUF_MALLOC_ERROR;
+	buf->pts = pts;
+	buf->capacity = new_capacity;
+	return CHAIN_BUF_TRUE;
+}
+
+int chain_buf_resize(ChainBuffer *buf, size_t len)
+{
+	int status = chain_buf_reserve(buf, len);
+	if (status != CHAIN_BUF_TRUE) return status;
+	buf->len = len;
+	return CHAIN_BUF_TRUE;
+}
+
+int chain_buf_push(ChainBuffer *buf, const Point3D *pt)
+{
+	int status = chain_buf_reserve(buf, buf->len + 1);
+	if (status != CHAIN_BUF_TRUE) return status;
+	buf->pts[buf->len++] = *pt;
+	return CHAIN_BUF_TRUE;
+}
+
+int chain_emit(const Point3D chain[], size_t N, size_t block,
+	chain_emit_fn emit, void *ctx)
+{
+	if (block == 0) block = N;
+	for (size_t start = 0; start < N; start += block)
+	{
+		size_t n = (N - start < block) ? N - start : block;
+		int status = emit(chain + start, n, ctx);
+		if (status != CHAIN_BUF_TRUE) return status;
+	}
+	return CHAIN_BUF_TRUE;
+}
+
+int chain_emit_fprint(const Point3D pts[], size_t n, void *ctx)
+{
+	return chain_fprint((FILE *)ctx, pts, n);
+}
+
+int chain_fprint(FILE *out, const Point3D chain[], size_t N)
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		if (fprintf(out, "%.2f, %.2f, %.2f\n", chain[i].x, chain[i].y, chain[i].z) < 0)
+		{
+			fprintf(stderr, "%s() error: could not write chain.\n", __func__);
+			return CHAIN_BUF_FALSE;
+		}
+	}
+	return CHAIN_BUF_TRUE;
+}
@@ -0,0 +1,64 @@
+#ifndef CHAIN_BUFFER_H_
+#define CHAIN_BUFFER_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include "point3d.h"
+
+#define CHAIN_BUF_TRUE 0
+#define CHAIN_BUF_FALSE -1
+#define CHAIN_BUF_MALLOC_ERROR -2
+
+/*
+ * Heap-backed, growable chain storage.
+ *
+ * The chain routines take plain Point3D arrays; a ChainBuffer owns one such
+ * array (pts[0 .. len - 1]) so chains of any length can live on the heap
+ * rather than in caller stack arrays.
+ */
+typedef struct
+{
+	Point3D *pts;
+	size_t len;
+	size_t capacity;
+} ChainBuffer, chain_buffer;
+
+/*
+ * Receives n consecutive monomers of a chain. Returning anything other than
+ * CHAIN_BUF_TRUE stops the stream and is passed back to the caller.
+ */
+typedef int (*chain_emit_fn)(const Point3D pts[], size_t n, void *ctx);
+
+int chain_buf_init(ChainBuffer *buf, size_t capacity);
+
+void chain_buf_destroy(ChainBuffer *buf);
+
+/* Make room for at least capacity monomers, keeping the current ones */
+int chain_buf_reserve(ChainBuffer *buf, size_t capacity);
+
+/* Set the length to len monomers, growing (contents unspecified) if needed */
+int chain_buf_resize(ChainBuffer *buf, size_t len);
+
+int chain_buf_push(ChainBuffer *buf, const Point3D *pt);
+
+static inline void chain_buf_clear(ChainBuffer *buf)
+{
+	buf->len = 0;
+}
+
+/*  Hand chain[0 .. N - 1] to emit in blocks of at most block monomers
+
+    Returns:
+        CHAIN_BUF_TRUE once every block was accepted
+        otherwise, the first non-CHAIN_BUF_TRUE value emit returned
+*/
+int chain_emit(const Point3D chain[], size_t N, size_t block,
+	chain_emit_fn emit, void *ctx);
+
+/* chain_emit_fn writing one "x, y, z" line per monomer to the FILE * in ctx */
+int chain_emit_fprint(const Point3D pts[], size_t n, void *ctx);
+
+/* Write one "x, y, z" line per monomer to out, without building a string */
+int chain_fprint(FILE *out, const Point3D chain[], size_t N);
+
+#endif /* CHAIN_BUFFER_H_ */
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dir_chain.h"
+
+/* bit 0 of every 3-bit code in a word; shift by 1 for y and 2 for x */
+#define CODE_LOW_BITS 0x1249249249249249ULL
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+LatticePoint dir_code_step(unsigned code)
+{
+	LatticePoint step = {
+		((code >> 2) & 1) ? 1 : -1,
+		((code >> 1) & 1) ? 1 : -1,
+		(code & 1) ? 1 : -1
+	};
+	return step;
+}
+
+int dir_code_of(const LatticePoint *step)
+{
+	if ((step->x != 1 && step->x != -1)
+		|| (step->y != 1 && step->y != -1)
+		|| (step->z != 1 && step->z != -1)) return -1;
+	return ((step->x > 0) << 2) | ((step->y > 0) << 1) | (step->z > 0);
+}
+
+int dir_chain_init(DirChain *chain, uint32_t capacity)
+{
+	chain->words = NULL;
+	chain->N = 0;
+	chain->capacity = 0;
+	chain->origin = (LatticePoint){0, 0, 0};
+	return dir_chain_reserve(chain, capacity);
+}
+
+void dir_chain_destroy(DirChain *chain)
+{
+	free(chain->words);
+	chain->words = NULL;
+	chain->N = 0;
+	chain->capacity = 0;
+}
+
+int dir_chain_reserve(DirChain *chain, uint32_t N)
+{
+	if (N <= chain->capacity && chain->words != NULL) return DIR_CHAIN_TRUE;
+	uint64_t num_words = dir_chain_num_words(N);
+	if (num_words == 0) num_words = 1;
+	uint64_t *words = (uint64_t *)realloc(chain->words, num_words * sizeof(uint64_t));
+	if (words == NULL) return DIR_CHAIN_MALLOC_ERROR;
+	chain->words = words;
+	chain->capacity = (uint32_t)(num_words * DIR_CODES_PER_WORD + 1);
+	return DIR_CHAIN_TRUE;
+}
+
+int dir_chain_encode(DirChain *chain, const Point3D pts[], uint32_t N)
+{
+	if (dir_chain_reserve(chain, N) != DIR_CHAIN_TRUE) return DIR_CHAIN_MALLOC_ERROR;
+
+	uint64_t num_words = dir_chain_num_words(N);
+	memset(chain->words, 0, num_words * sizeof(uint64_t));
+	chain->N = N;
+	if (N == 0) return DIR_CHAIN_TRUE;
+
+	LatticePoint prev = lat_from_pt(&pts[0]);
+	chain->origin = prev;
+	for (uint32_t i = 0; i + 1 < N; i++)
+	{
+		LatticePoint cur = lat_from_pt(&pts[i + 1]);
+		LatticePoint step = {cur.x - prev.x, cur.y - prev.y, cur.z - prev.z};
+		int code = dir_code_of(&step);
+		if (code < 0)
+		{
+			chain->N = 0;
+			return DIR_CHAIN_INVALID_STEP;
+		}
+		chain->words[i / DIR_CODES_PER_WORD] |=
+			(uint64_t)code << (DIR_CODE_BITS * (i % DIR_CODES_PER_WORD));
+		prev = cur;
+	}
+	return DIR_CHAIN_TRUE;
+}
+
+void dir_chain_decode(const DirChain *chain, Point3D pts[])
+{
+	if (chain->N == 0) return;
+
+	int32_t x = chain->origin.x, y = chain->origin.y, z = chain->origin.z;
+	pts[0] = (Point3D){(float)x, (float)y, (float)z};
+	uint32_t i = 1;
+	uint64_t num_words = dir_chain_num_words(chain->N);
+	for (uint64_t w = 0; w < num_words; w++)
+	{
+		// walk one word at a time instead of re-indexing per step
+		uint64_t word = chain->words[w];
+		for (int c = 0; c < DIR_CODES_PER_WORD && i < chain->N; c++, i++)
+		{
+			x += (int32_t)((word >> 1) & 2) - 1;
+			y += (int32_t)(word & 2) - 1;
+			z += (int32_t)((word << 1) & 2) - 1;
+			pts[i] = (Point3D){(float)x, (float)y, (float)z};
+			word >>= DIR_CODE_BITS;
+		}
+	}
+}
+
+LatticePoint dir_chain_end(const DirChain *chain)
+{
+	if (chain->N < 2) return chain->origin;
+
+	// each axis moves +1 for every set bit and -1 for every clear one
+	int64_t up_x = 0, up_y = 0, up_z = 0;
+	uint64_t num_words = dir_chain_num_words(chain->N);
+	for (uint64_t w = 0; w < num_words; w++)
+	{
+		uint64_t word = chain->words[w];
+		up_x += __builtin_popcountll(word & (CODE_LOW_BITS << 2));
+		up_y += __builtin_popcountll(word & (CODE_LOW_BITS << 1));
+		up_z += __builtin_popcountll(word & CODE_LOW_BITS);
+	}
+	int64_t steps = (int64_t)chain->N - 1;
+	LatticePoint end = {
+		chain->origin.x + (int32_t)(2 * up_x - steps),
+		chain->origin.y + (int32_t)(2 * up_y - steps),
+		chain->origin.z + (int32_t)(2 * up_z - steps)
+	};
+	return end;
+}
+
+bool dir_chain_is_closed(const DirChain *chain)
+{
+	if (chain->N < 2) return false;
+	LatticePoint end = dir_chain_end(chain);
+	LatticePoint step = {
+		chain->origin.x - end.x,
+		chain->origin.y - end.y,
+		chain->origin.z - end.z
+	};
+	return dir_code_of(&step) >= 0;
+}
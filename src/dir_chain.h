@@ -0,0 +1,82 @@
+#ifndef DIR_CHAIN_H_
+#define DIR_CHAIN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "point3d.h"
+#include "lattice.h"
+
+#define DIR_CHAIN_TRUE 0
+#define DIR_CHAIN_MALLOC_ERROR -2
+#define DIR_CHAIN_INVALID_STEP -9
+
+/*
+ * Chains stored as direction codes.
+ *
+ * Every step of a chain built from gen_all_bin_list3 is one of its 8
+ * directions, so a step fits in 3 bits: bit 2 is set iff the step is +1 in x,
+ * bit 1 iff +1 in y, bit 0 iff +1 in z. That is exactly the step's index in
+ * the gen_all_bin_list3 list. Codes are packed 21 to a 64-bit word (bit 63 is
+ * unused), so a chain costs 3/8 of a byte per monomer instead of 12 bytes.
+ *
+ * Only the N - 1 steps between consecutive monomers are stored; monomer 0 is
+ * kept as origin, and coordinates are recovered by a prefix sum.
+ */
+
+#define DIR_CODES_PER_WORD 21
+#define DIR_CODE_BITS 3
+#define DIR_CODE_MASK 0x7u
+
+typedef struct
+{
+	uint64_t *words;
+	uint32_t N;              /* monomers; N - 1 steps are stored */
+	uint32_t capacity;       /* monomers the words can hold */
+	LatticePoint origin;     /* monomer 0 */
+} DirChain, dir_chain;
+
+/* Number of words needed for a chain of N monomers */
+static inline uint64_t dir_chain_num_words(uint32_t N)
+{
+	return N > 1 ? ((uint64_t)N - 2) / DIR_CODES_PER_WORD + 1 : 0;
+}
+
+/* The code of step i (from monomer i to monomer i + 1) */
+static inline unsigned dir_chain_code(const DirChain *chain, uint32_t i)
+{
+	return (unsigned)(chain->words[i / DIR_CODES_PER_WORD]
+		>> (DIR_CODE_BITS * (i % DIR_CODES_PER_WORD))) & DIR_CODE_MASK;
+}
+
+/* The step vector of a code, and the code of a step (-1 if not a lattice step) */
+LatticePoint dir_code_step(unsigned code);
+
+int dir_code_of(const LatticePoint *step);
+
+int dir_chain_init(DirChain *chain, uint32_t capacity);
+
+void dir_chain_destroy(DirChain *chain);
+
+/* Make room for at least N monomers; the current codes are kept */
+int dir_chain_reserve(DirChain *chain, uint32_t N);
+
+/*  Encode pts[0 .. N - 1], growing the chain's storage if needed
+
+    Returns:
+        DIR_CHAIN_TRUE on success
+        DIR_CHAIN_INVALID_STEP if two consecutive monomers are not one
+            gen_all_bin_list3 step apart
+        DIR_CHAIN_MALLOC_ERROR if the storage could not grow
+*/
+int dir_chain_encode(DirChain *chain, const Point3D pts[], uint32_t N);
+
+/* Decode all N monomers into pts by summing the steps from the origin */
+void dir_chain_decode(const DirChain *chain, Point3D pts[]);
+
+/* Position of the last monomer, from popcounts over the packed codes */
+LatticePoint dir_chain_end(const DirChain *chain);
+
+/* Same test as is_closed, on the step codes alone */
+bool dir_chain_is_closed(const DirChain *chain);
+
+#endif /* DIR_CHAIN_H_ */
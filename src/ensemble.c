@@ -0,0 +1,119 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "ensemble.h"
+
+/* state shared by every worker of one ensemble_generate call */
+struct ensemble_job
+{
+	Point3D *chains;
+	int *attempts;
+	const EnsembleParams *params;
+	Point3D *dirs;
+	int dirs_len;
+	int dim;
+	int next_chain; /* claimed with an atomic fetch-and-add */
+	int generated;  /* chains finished, counted the same way */
+};
+
+static void *__worker(void *arg);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+void ensemble_stream(uint32_t seed, int chain_index,
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	key->v[0] = seed;
+	key->v[1] = (uint32_t)chain_index;
+	ctr->v[0] = 0;
+	ctr->v[1] = 0;
+}
+
+int regenerate_chain(Point3D chain[], const EnsembleParams *params, int k,
+	int first_attempt, Point3D dirs[], int dirs_len, int dim)
+{
+	assert(k >= 0 && first_attempt >= 0);
+	// a walk on the bipartite lattice only returns after an even number of steps
+	if (params->N < 4 || params->N % 2 != 0) return ENS_INVALID_PARAMS;
+	OccBitmap occ;
+	if (occ_bitmap_init(&occ, params->N) != OCC_TRUE) return ENS_MALLOC_ERROR;
+	threefry2x32_ctr_t ctr;
+	threefry2x32_key_t key;
+	ensemble_stream(params->seed, k, &ctr, &key);
+	ctr.v[1] = (uint32_t)first_attempt;
+	int attempts = sample_closed_chain(chain, params->N, dirs, dirs_len, dim, &occ, &ctr, &key);
+	occ_bitmap_destroy(&occ);
+	return attempts == OCC_MALLOC_ERROR ? ENS_MALLOC_ERROR : first_attempt + attempts;
+}
+
+int ensemble_generate(Point3D *chains, int *attempts,
+	const EnsembleParams *params, Point3D dirs[], int dirs_len, int dim)
+{
+	if (params->N < 4 || params->N % 2 != 0 || params->num_chains < 0) return ENS_INVALID_PARAMS;
+	struct ensemble_job job = {
+		.chains     = chains,
+		.attempts   = attempts,
+		.params     = params,
+		.dirs       = dirs,
+		.dirs_len   = dirs_len,
+		.dim        = dim,
+		.next_chain = 0,
+		.generated  = 0
+	};
+
+	int num_threads = params->num_threads > 0 ? params->num_threads : 1;
+	if (num_threads > params->num_chains) num_threads = params->num_chains;
+	if (num_threads <= 1)
+	{
+		__worker(&job);
+		return job.generated == params->num_chains ? ENS_TRUE : ENS_MALLOC_ERROR;
+	}
+
+	pthread_t *threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+	if (threads == NULL) return ENS_MALLOC_ERROR;
+	int started = 0;
+	for (; started < num_threads; started++)
+	{
+		// chains are claimed dynamically, so if we cannot start every thread
+		// the ones already running still cover the whole ensemble
+		if (pthread_create(&threads[started], NULL, __worker, &job) != 0) break;
+	}
+	if (started == 0) __worker(&job);
+	for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+	free(threads);
+	// a worker that could not allocate claims no chains and leaves them to
+	// the others, so only chains nobody generated are a failure
+	return job.generated == params->num_chains ? ENS_TRUE : ENS_MALLOC_ERROR;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static void *__worker(void *arg)
+{
+	struct ensemble_job *job = (struct ensemble_job *)arg;
+	int N = job->params->N;
+
+	// one occupancy bitmap per worker, reset in O(1) between attempts
+	OccBitmap occ;
+	if (occ_bitmap_init(&occ, N) != OCC_TRUE) return NULL;
+
+	int k;
+	while ((k = __sync_fetch_and_add(&job->next_chain, 1)) < job->params->num_chains)
+	{
+		threefry2x32_ctr_t ctr;
+		threefry2x32_key_t key;
+		ensemble_stream(job->params->seed, k, &ctr, &key);
+		Point3D *chain = job->chains + (size_t)k * N;
+		int tries = sample_closed_chain(chain, N, job->dirs, job->dirs_len,
+			job->dim, &occ, &ctr, &key);
+		if (tries == OCC_MALLOC_ERROR) continue;
+		if (job->attempts) job->attempts[k] = tries;
+		__sync_fetch_and_add(&job->generated, 1);
+	}
+	occ_bitmap_destroy(&occ);
+	return NULL;
+}
@@ -0,0 +1,67 @@
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include <stdint.h>
+#include "chain.h"
+
+#define ENS_TRUE 0
+#define ENS_MALLOC_ERROR -2
+#define ENS_INVALID_PARAMS -3
+
+/*
+ * ctr.v[1] bit for a chain's draws outside generation (e.g. analysis), which
+ * can never collide with an attempt's counters
+ */
+#define ENS_AUX_STREAM 0x80000000u
+
+/*
+ * Parameters for generating an ensemble of closed chains.
+ *
+ * Chain k of an ensemble draws all of its randomness from its own
+ * counter-based stream, keyed on (seed, k), so the ensemble is bit-identical
+ * for any num_threads and any scheduling of chains onto threads. Within the
+ * stream, step i of attempt a draws from the block at counter {i, a} (see
+ * sample_closed_chain), so any chain can be regenerated alone, and any of
+ * its attempts replayed.
+ */
+typedef struct
+{
+	int N;           /* monomers per chain */
+	int num_chains;
+	int num_threads; /* <= 0 means one thread */
+	uint32_t seed;
+} EnsembleParams, ensemble_params;
+
+/* Initialize the Random123 stream owned by chain chain_index of a run */
+void ensemble_stream(uint32_t seed, int chain_index,
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+/*  Regenerate chain k of the ensemble params describes into chain (N
+    points), exactly as ensemble_generate made it, without the chains before
+    it. Attempts before first_attempt are skipped: pass the attempts that
+    ensemble_generate reported minus one to replay only the successful one,
+    or 0 if unknown.
+
+    Returns:
+        the attempt count, as ensemble_generate would report it
+        ENS_INVALID_PARAMS if N is odd or below 4, so no walk can close
+        ENS_MALLOC_ERROR if the occupancy bitmap could not be allocated or grown
+*/
+int regenerate_chain(Point3D chain[], const EnsembleParams *params, int k,
+	int first_attempt, Point3D dirs[], int dirs_len, int dim);
+
+/*  Generate params->num_chains closed chains of params->N monomers each into
+    chains, which must hold num_chains * N points; chain k starts at
+    chains + k * N. If attempts is non-NULL, attempts[k] receives the number of
+    worm attempts chain k took.
+
+    Returns:
+        ENS_TRUE on success
+        ENS_INVALID_PARAMS if N is odd or below 4, or num_chains is negative
+        ENS_MALLOC_ERROR if some chain was left ungenerated because a
+            worker could not allocate or grow its occupancy bitmap
+*/
+int ensemble_generate(Point3D *chains, int *attempts,
+	const EnsembleParams *params, Point3D dirs[], int dirs_len, int dim);
+
+#endif /* ENSEMBLE_H_ */
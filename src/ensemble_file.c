@@ -0,0 +1,339 @@
+#define _POSIX_C_SOURCE 200809L /* mmap, fstat */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ensemble_file.h"
+#include "lattice.h"
+
+#define WRITE_BLOCK 1024 /* monomers converted per fwrite */
+
+/* leads every ENS_ENC_DIRCODE record */
+typedef struct
+{
+	uint32_t N;
+	int32_t x, y, z;
+} DirRecord;
+
+/* PRIVATE FUNCTIONS */
+static int __pad_to_align(EnsWriter *writer);
+static int __push_offset(EnsWriter *writer, uint64_t offset);
+static int __write_int32(EnsWriter *writer, const Point3D chain[], uint32_t N);
+static int __write_dircode(EnsWriter *writer, const Point3D chain[], uint32_t N);
+static void __view_dircode(const EnsReader *reader, uint64_t k, DirChain *view);
+static bool __index_valid(const EnsReader *reader);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+void ens_header_init(EnsHeader *header, uint32_t N, uint32_t seed)
+{
+	memset(header, 0, sizeof(EnsHeader));
+	memcpy(header->magic, ENS_FILE_MAGIC, sizeof(header->magic));
+	header->version = ENS_FILE_VERSION;
+	header->lattice = ENS_LATTICE_BCC;
+	header->encoding = ENS_ENC_INT32;
+	header->N = N;
+	header->seed = seed;
+}
+
+int ens_writer_open(EnsWriter *writer, const char *path, const EnsHeader *header)
+{
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL)
+	{
+		fprintf(stderr, "%s() error: could not create %s.\n", __func__, path);
+		return ENS_FILE_IO_ERROR;
+	}
+	writer->header = *header;
+	writer->header.num_chains = 0;
+	writer->header.index_offset = 0;
+	writer->offsets = NULL;
+	writer->num_offsets = 0;
+	writer->capacity = 0;
+	if (fwrite(&writer->header, sizeof(EnsHeader), 1, writer->file) != 1)
+	{
+		fclose(writer->file);
+		return ENS_FILE_IO_ERROR;
+	}
+	writer->end = sizeof(EnsHeader);
+	if (dir_chain_init(&writer->codes, 0) != DIR_CHAIN_TRUE)
+	{
+		fclose(writer->file);
+		return ENS_FILE_MALLOC_ERROR;
+	}
+	return ENS_FILE_TRUE;
+}
+
+int ens_writer_add(EnsWriter *writer, const Point3D chain[], uint32_t N)
+{
+	if (__push_offset(writer, writer->end) != ENS_FILE_TRUE) return ENS_FILE_MALLOC_ERROR;
+
+	int status = writer->header.encoding == ENS_ENC_DIRCODE
+		? __write_dircode(writer, chain, N)
+		: __write_int32(writer, chain, N);
+	if (status != ENS_FILE_TRUE)
+	{
+		writer->num_offsets--;
+		return status;
+	}
+	writer->header.num_chains++;
+	return ENS_FILE_TRUE;
+}
+
+int ens_writer_close(EnsWriter *writer)
+{
+	int status = ENS_FILE_TRUE;
+	// the final offset closes off the last chain; the index itself is aligned
+	if (__push_offset(writer, writer->end) != ENS_FILE_TRUE
+		|| __pad_to_align(writer) != ENS_FILE_TRUE) status = ENS_FILE_IO_ERROR;
+	if (status == ENS_FILE_TRUE)
+	{
+		writer->header.index_offset = writer->end;
+		if (fwrite(writer->offsets, sizeof(uint64_t), writer->num_offsets, writer->file)
+				!= writer->num_offsets
+			|| fseek(writer->file, 0, SEEK_SET) != 0
+			|| fwrite(&writer->header, sizeof(EnsHeader), 1, writer->file) != 1)
+		{
+			status = ENS_FILE_IO_ERROR;
+		}
+	}
+	if (fclose(writer->file) != 0) status = ENS_FILE_IO_ERROR;
+	writer->file = NULL;
+	free(writer->offsets);
+	writer->offsets = NULL;
+	writer->num_offsets = 0;
+	writer->capacity = 0;
+	dir_chain_destroy(&writer->codes);
+	return status;
+}
+
+int ens_reader_open(EnsReader *reader, const char *path)
+{
+	reader->map = NULL;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		fprintf(stderr, "%s() error: could not open %s.\n", __func__, path);
+		return ENS_FILE_IO_ERROR;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(EnsHeader))
+	{
+		close(fd);
+		return ENS_FILE_FORMAT_ERROR;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return ENS_FILE_IO_ERROR;
+
+	reader->map = (const unsigned char *)map;
+	reader->size = st.st_size;
+	reader->header = (const EnsHeader *)reader->map;
+	reader->index = NULL;
+	const EnsHeader *header = reader->header;
+	// num_chains + 1 offsets must fit between index_offset and the end, which
+	// bounds num_chains before anything is multiplied by it
+	if (memcmp(header->magic, ENS_FILE_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != ENS_FILE_VERSION
+		|| (header->encoding != ENS_ENC_INT32 && header->encoding != ENS_ENC_DIRCODE)
+		|| header->index_offset < sizeof(EnsHeader)
+		|| header->index_offset > reader->size
+		|| header->index_offset % sizeof(uint64_t) != 0
+		|| header->num_chains >= (reader->size - header->index_offset) / sizeof(uint64_t))
+	{
+		ens_reader_close(reader);
+		return ENS_FILE_FORMAT_ERROR;
+	}
+	reader->index = (const uint64_t *)(reader->map + header->index_offset);
+	if (!__index_valid(reader))
+	{
+		ens_reader_close(reader);
+		return ENS_FILE_FORMAT_ERROR;
+	}
+	return ENS_FILE_TRUE;
+}
+
+void ens_reader_close(EnsReader *reader)
+{
+	if (reader->map) munmap((void *)reader->map, reader->size);
+	reader->map = NULL;
+	reader->header = NULL;
+	reader->index = NULL;
+	reader->size = 0;
+}
+
+uint32_t ens_reader_chain_len(const EnsReader *reader, uint64_t k)
+{
+	if (k >= reader->header->num_chains) return 0;
+	if (reader->header->encoding == ENS_ENC_DIRCODE)
+	{
+		return ((const DirRecord *)(reader->map + reader->index[k]))->N;
+	}
+	return (uint32_t)((reader->index[k + 1] - reader->index[k]) / (3 * sizeof(int32_t)));
+}
+
+int ens_reader_chain(const EnsReader *reader, uint64_t k, Point3D chain[])
+{
+	if (k >= reader->header->num_chains) return ENS_FILE_FALSE;
+	if (reader->header->encoding == ENS_ENC_DIRCODE)
+	{
+		DirChain view;
+		__view_dircode(reader, k, &view);
+		dir_chain_decode(&view, chain);
+		return ENS_FILE_TRUE;
+	}
+	const int32_t *coords = (const int32_t *)(reader->map + reader->index[k]);
+	uint32_t N = ens_reader_chain_len(reader, k);
+	for (uint32_t i = 0; i < N; i++)
+	{
+		chain[i].x = (float)coords[3 * i];
+		chain[i].y = (float)coords[3 * i + 1];
+		chain[i].z = (float)coords[3 * i + 2];
+	}
+	return ENS_FILE_TRUE;
+}
+
+int ens_reader_dir_chain(const EnsReader *reader, uint64_t k, DirChain *codes)
+{
+	if (k >= reader->header->num_chains) return ENS_FILE_FALSE;
+	if (reader->header->encoding != ENS_ENC_DIRCODE)
+	{
+		uint32_t N = ens_reader_chain_len(reader, k);
+		Point3D *chain = (Point3D *)malloc((N ? N : 1) * sizeof(Point3D));
+		if (chain == NULL) return ENS_FILE_MALLOC_ERROR;
+		ens_reader_chain(reader, k, chain);
+		int status = dir_chain_encode(codes, chain, N);
+		free(chain);
+		if (status == DIR_CHAIN_MALLOC_ERROR) return ENS_FILE_MALLOC_ERROR;
+		return status == DIR_CHAIN_TRUE ? ENS_FILE_TRUE : ENS_FILE_FORMAT_ERROR;
+	}
+
+	DirChain view;
+	__view_dircode(reader, k, &view);
+	if (dir_chain_reserve(codes, view.N) != DIR_CHAIN_TRUE) return ENS_FILE_MALLOC_ERROR;
+	memcpy(codes->words, view.words, dir_chain_num_words(view.N) * sizeof(uint64_t));
+	codes->N = view.N;
+	codes->origin = view.origin;
+	return ENS_FILE_TRUE;
+}
+
+int ens_write_chains(const char *path, const EnsHeader *header,
+	const Point3D *chains, uint64_t num_chains)
+{
+	EnsWriter writer;
+	int status = ens_writer_open(&writer, path, header);
+	if (status != ENS_FILE_TRUE) return status;
+	for (uint64_t k = 0; k < num_chains && status == ENS_FILE_TRUE; k++)
+	{
+		status = ens_writer_add(&writer, chains + k * header->N, header->N);
+	}
+	int close_status = ens_writer_close(&writer);
+	return status != ENS_FILE_TRUE ? status : close_status;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static int __pad_to_align(EnsWriter *writer)
+{
+	static const unsigned char zeros[ENS_FILE_ALIGN] = {0};
+	uint64_t pad = (ENS_FILE_ALIGN - writer->end % ENS_FILE_ALIGN) % ENS_FILE_ALIGN;
+	if (pad && fwrite(zeros, 1, pad, writer->file) != pad) return ENS_FILE_IO_ERROR;
+	writer->end += pad;
+	return ENS_FILE_TRUE;
+}
+
+static int __write_int32(EnsWriter *writer, const Point3D chain[], uint32_t N)
+{
+	int32_t block[3 * WRITE_BLOCK];
+	for (uint32_t start = 0; start < N; start += WRITE_BLOCK)
+	{
+		uint32_t n = (N - start < WRITE_BLOCK) ? N - start : WRITE_BLOCK;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			LatticePoint p = lat_from_pt(&chain[start + i]);
+			block[3 * i] = p.x;
+			block[3 * i + 1] = p.y;
+			block[3 * i + 2] = p.z;
+		}
+		if (fwrite(block, 3 * sizeof(int32_t), n, writer->file) != n) return ENS_FILE_IO_ERROR;
+	}
+	writer->end += (uint64_t)N * 3 * sizeof(int32_t);
+	return ENS_FILE_TRUE;
+}
+
+static int __write_dircode(EnsWriter *writer, const Point3D chain[], uint32_t N)
+{
+	int status = dir_chain_encode(&writer->codes, chain, N);
+	if (status == DIR_CHAIN_MALLOC_ERROR) return ENS_FILE_MALLOC_ERROR;
+	if (status != DIR_CHAIN_TRUE) return ENS_FILE_FORMAT_ERROR;
+
+	DirRecord record = {N, writer->codes.origin.x, writer->codes.origin.y, writer->codes.origin.z};
+	uint64_t num_words = dir_chain_num_words(N);
+	if (fwrite(&record, sizeof(DirRecord), 1, writer->file) != 1
+		|| fwrite(writer->codes.words, sizeof(uint64_t), num_words, writer->file) != num_words)
+	{
+		return ENS_FILE_IO_ERROR;
+	}
+	writer->end += sizeof(DirRecord) + num_words * sizeof(uint64_t);
+	return ENS_FILE_TRUE;
+}
+
+/* A read-only DirChain pointing straight into the mapped record */
+static void __view_dircode(const EnsReader *reader, uint64_t k, DirChain *view)
+{
+	const DirRecord *record = (const DirRecord *)(reader->map + reader->index[k]);
+	view->words = (uint64_t *)(record + 1);
+	view->N = record->N;
+	view->capacity = record->N;
+	view->origin = (LatticePoint){record->x, record->y, record->z};
+}
+
+/*
+ * Whether every record lies within the payload, [sizeof(EnsHeader),
+ * index_offset), in order, aligned for its encoding, and exactly as long as
+ * the monomers it claims. The accessors trust the index after this.
+ */
+static bool __index_valid(const EnsReader *reader)
+{
+	const EnsHeader *header = reader->header;
+	const uint64_t *index = reader->index;
+	if (index[0] < sizeof(EnsHeader) || index[header->num_chains] > header->index_offset) return false;
+	for (uint64_t k = 0; k < header->num_chains; k++)
+	{
+		if (index[k + 1] < index[k]) return false;
+		uint64_t len = index[k + 1] - index[k];
+		if (header->encoding == ENS_ENC_DIRCODE)
+		{
+			if (index[k] % sizeof(uint64_t) != 0 || len < sizeof(DirRecord)) return false;
+			uint32_t N = ((const DirRecord *)(reader->map + index[k]))->N;
+			if (len != sizeof(DirRecord) + dir_chain_num_words(N) * sizeof(uint64_t)) return false;
+		}
+		else if (index[k] % sizeof(int32_t) != 0 || len % (3 * sizeof(int32_t)) != 0
+			|| len / (3 * sizeof(int32_t)) > UINT32_MAX)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static int __push_offset(EnsWriter *writer, uint64_t offset)
+{
+	if (writer->num_offsets == writer->capacity)
+	{
+		uint64_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+		uint64_t *offsets = (uint64_t *)realloc(writer->offsets, capacity * sizeof(uint64_t));
+		if (offsets == NULL) return ENS_FILE_MALLOC_ERROR;
+		writer->offsets = offsets;
+		writer->capacity = capacity;
+	}
+	writer->offsets[writer->num_offsets++] = offset;
+	return ENS_FILE_TRUE;
+}
@@ -0,0 +1,139 @@
+#ifndef ENSEMBLE_FILE_H_
+#define ENSEMBLE_FILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "point3d.h"
+#include "dir_chain.h"
+
+/*
+ * Binary ensemble files.
+ *
+ * Layout (native byte order, sections 64-byte aligned so the file can be
+ * mmap'd and read in place):
+ *
+ *     EnsHeader                   64 bytes
+ *     payload of chain 0, 1, ...  back to back
+ *     index                       num_chains + 1 uint64 file offsets;
+ *                                 chain k spans [index[k], index[k + 1])
+ *
+ * The index goes last so a writer can stream chains without knowing how
+ * many there will be; header.index_offset is filled in on close.
+ *
+ * With ENS_ENC_INT32 a chain of n monomers is 3n int32 coordinates. With
+ * ENS_ENC_DIRCODE it is a uint32 n, the int32 x, y, z of monomer 0, then the
+ * dir_chain_num_words(n) packed uint64 words of its step codes (see
+ * dir_chain.h); records stay 8-byte aligned so the words can be read in place.
+ *
+ * header.seed is all it takes to regenerate a chain: chain k of a run draws
+ * from its own Random123 stream, ensemble_stream(seed, k), starting at
+ * counter 0, so regenerate_chain rebuilds it alone. Version 1 headers also
+ * held a start counter that was never set; those files are rejected.
+ */
+
+#define ENS_FILE_MAGIC "TLENS\0\0\0"
+#define ENS_FILE_VERSION 2
+#define ENS_FILE_ALIGN 64
+
+/* lattices */
+#define ENS_LATTICE_BCC 1 /* steps from gen_all_bin_list3 */
+
+/* payload encodings */
+#define ENS_ENC_INT32 0   /* x, y, z as int32 per monomer */
+#define ENS_ENC_DIRCODE 1 /* origin plus 3-bit step codes */
+
+#define ENS_FILE_TRUE 0
+#define ENS_FILE_FALSE -1
+#define ENS_FILE_MALLOC_ERROR -2
+#define ENS_FILE_IO_ERROR -7
+#define ENS_FILE_FORMAT_ERROR -8
+
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t lattice;
+	uint32_t encoding;
+	uint32_t N;            /* monomers per chain; 0 if chains vary */
+	uint64_t num_chains;
+	uint64_t index_offset; /* 0 until the writer is closed */
+	uint32_t seed;         /* chain k came from stream ensemble_stream(seed, k) */
+	uint32_t box;          /* side of the periodic box of a melt (melt.h); 0 if none */
+	uint32_t reserved[4];
+} EnsHeader, ens_header;
+
+typedef struct
+{
+	FILE *file;
+	EnsHeader header;
+	uint64_t *offsets;     /* start of every chain written so far */
+	uint64_t num_offsets;
+	uint64_t capacity;
+	uint64_t end;          /* current end of the payload */
+	DirChain codes;        /* scratch for ENS_ENC_DIRCODE */
+} EnsWriter, ens_writer;
+
+typedef struct
+{
+	const unsigned char *map;
+	uint64_t size;
+	const EnsHeader *header;
+	const uint64_t *index;
+} EnsReader, ens_reader;
+
+/* Fill a header with the magic, version, lattice and encoding defaults */
+void ens_header_init(EnsHeader *header, uint32_t N, uint32_t seed);
+
+/*  Create path and write header; chains follow with ens_writer_add
+
+    Returns:
+        ENS_FILE_TRUE on success
+        ENS_FILE_IO_ERROR if the file could not be created
+*/
+int ens_writer_open(EnsWriter *writer, const char *path, const EnsHeader *header);
+
+/*  Append one chain of N monomers in the header's encoding
+
+    Returns:
+        ENS_FILE_TRUE on success
+        ENS_FILE_FORMAT_ERROR if the encoding is ENS_ENC_DIRCODE and the chain
+            is not made of lattice steps
+        ENS_FILE_MALLOC_ERROR or ENS_FILE_IO_ERROR otherwise
+*/
+int ens_writer_add(EnsWriter *writer, const Point3D chain[], uint32_t N);
+
+/* Write the index and final header, then close the file */
+int ens_writer_close(EnsWriter *writer);
+
+/*  Map path read-only and check its header
+
+    Returns:
+        ENS_FILE_TRUE on success
+        ENS_FILE_IO_ERROR if the file could not be opened or mapped
+        ENS_FILE_FORMAT_ERROR if it is not a complete ensemble file, or its
+            index points outside the payload or at records of the wrong
+            length
+*/
+int ens_reader_open(EnsReader *reader, const char *path);
+
+void ens_reader_close(EnsReader *reader);
+
+static inline uint64_t ens_reader_count(const EnsReader *reader)
+{
+	return reader->header->num_chains;
+}
+
+/* Number of monomers in chain k, or 0 if there is no chain k */
+uint32_t ens_reader_chain_len(const EnsReader *reader, uint64_t k);
+
+/* Decode chain k into chain, which must hold ens_reader_chain_len monomers */
+int ens_reader_chain(const EnsReader *reader, uint64_t k, Point3D chain[]);
+
+/* Load the step codes of chain k into codes (either encoding) */
+int ens_reader_dir_chain(const EnsReader *reader, uint64_t k, DirChain *codes);
+
+/* Write num_chains chains of N monomers, stored back to back, to path */
+int ens_write_chains(const char *path, const EnsHeader *header,
+	const Point3D *chains, uint64_t num_chains);
+
+#endif /* ENSEMBLE_FILE_H_ */
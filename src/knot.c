@@ -0,0 +1,603 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "knot.h"
+#include "bvh.h"
+#include "lattice.h"
+
+#define NUM_PROJECTIONS 4
+#define PARAM_EPS 1e-9   /* crossings this close to a vertex are degenerate */
+#define HEIGHT_EPS 1e-9
+#define PIVOT_EPS 1e-12  /* relative size below which eliminated entries vanish */
+#define KMT_BLOCKED 1
+
+/*
+ * Lattice rings are full of coplanar bonds, and the triangle test counts a
+ * coplanar or touching segment as blocking, so on the raw sites few vertices
+ * would go and projections would cross at vertices. Sites are scaled by
+ * KNOT_SCALE and each moved by a pseudo-random offset of at most KNOT_JITTER
+ * per axis, fixed by the site, to put the ring in general position for the
+ * triangle and crossing tests. The offset is far less than the gap between
+ * any two disjoint bonds, so it cannot change the knot type, and the moved
+ * sites are still integers for the exact predicates.
+ */
+#define KNOT_SCALE 1024
+#define KNOT_JITTER 31
+
+/* working state of one knot_simplify call */
+struct kmt
+{
+	LatticePoint *lat;
+	Point3D *pts;      /* the same sites, for the BVH */
+	int *prev, *next;
+	bool *alive;
+	int n;
+	int p, i, q;       /* vertex i and its neighbours, the triangle under test */
+	int32_t lo[3], hi[3]; /* the triangle's bounding box */
+};
+
+/* a crossing of the projected ring */
+struct crossing
+{
+	int over_seg, under_seg;
+	double over_t, under_t;
+	int sign;
+	int over_arc, in_arc, out_arc;
+};
+
+/* one passage of the ring through a crossing, for ordering along the ring */
+struct passage
+{
+	int seg;
+	double t;
+	int crossing;
+	bool under;
+};
+
+struct sparse_row
+{
+	int *cols;
+	double complex *vals;
+	int len, cap;
+};
+
+/* PRIVATE FUNCTIONS */
+static LatticePoint __perturbed_site(const Point3D *pt);
+static int __kmt_pass(struct kmt *k, bool *removed);
+static int __kmt_visit(int seg, void *ctx);
+static inline int __orient3d(const LatticePoint *a, const LatticePoint *b,
+	const LatticePoint *c, const LatticePoint *d);
+static bool __seg_hits_triangle(const LatticePoint *s0, const LatticePoint *s1,
+	const LatticePoint *a, const LatticePoint *b, const LatticePoint *c);
+static int __crossings(const Point3D pts[], int n, int projection,
+	struct crossing **out, int *num);
+static int __cmp_passage(const void *a, const void *b);
+static int __label_arcs(struct crossing *cr, int num);
+static int __row_add(struct sparse_row *row, int col, double complex val);
+static int __sparse_det(struct sparse_row *rows, int m, double complex *det);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int knot_simplify(const Point3D chain[], int N, Point3D out[], int *M)
+{
+	if (N < 3) return KNOT_INVALID_CHAIN;
+
+	struct kmt k;
+	k.lat = (LatticePoint *)malloc(N * sizeof(LatticePoint));
+	k.pts = (Point3D *)malloc(N * sizeof(Point3D));
+	k.prev = (int *)malloc(N * sizeof(int));
+	k.next = (int *)malloc(N * sizeof(int));
+	k.alive = (bool *)malloc(N * sizeof(bool));
+	int status = KNOT_TRUE;
+	if (!k.lat || !k.pts || !k.prev || !k.next || !k.alive) status = KNOT_MALLOC_ERROR;
+
+	if (status == KNOT_TRUE)
+	{
+		k.n = N;
+		for (int v = 0; v < N; v++) k.lat[v] = __perturbed_site(&chain[v]);
+		bool removed = true;
+		while (removed && k.n > 3 && status == KNOT_TRUE) status = __kmt_pass(&k, &removed);
+	}
+	if (status == KNOT_TRUE)
+	{
+		for (int v = 0; v < k.n; v++)
+		{
+			out[v].x = (float)k.lat[v].x / KNOT_SCALE;
+			out[v].y = (float)k.lat[v].y / KNOT_SCALE;
+			out[v].z = (float)k.lat[v].z / KNOT_SCALE;
+		}
+		*M = k.n;
+	}
+	free(k.lat);
+	free(k.pts);
+	free(k.prev);
+	free(k.next);
+	free(k.alive);
+	return status;
+}
+
+int knot_alexander(const Point3D chain[], int N, double complex t, double *abs_delta)
+{
+	*abs_delta = 0.0;
+	if (N < 3) return KNOT_INVALID_CHAIN;
+	Point3D *pts = (Point3D *)malloc(N * sizeof(Point3D));
+	if (pts == NULL) return KNOT_MALLOC_ERROR;
+	int n;
+	int status = knot_simplify(chain, N, pts, &n);
+
+	// try a few generic projections until one has no degenerate crossing
+	struct crossing *cr = NULL;
+	int num = 0;
+	if (status == KNOT_TRUE) status = KNOT_DEGENERATE;
+	for (int proj = 0; proj < NUM_PROJECTIONS && status == KNOT_DEGENERATE; proj++)
+	{
+		free(cr);
+		cr = NULL;
+		status = __crossings(pts, n, proj, &cr, &num);
+	}
+	if (status == KNOT_TRUE) status = __label_arcs(cr, num);
+
+	if (status == KNOT_TRUE && num <= 1)
+	{
+		// no crossings, or one nugatory one: the unknot
+		*abs_delta = 1.0;
+	}
+	else if (status == KNOT_TRUE)
+	{
+		// Alexander matrix: a row per crossing, a column per arc; drop the
+		// last row and column
+		int m = num - 1;
+		struct sparse_row *rows = (struct sparse_row *)calloc(m, sizeof(struct sparse_row));
+		if (rows == NULL) status = KNOT_MALLOC_ERROR;
+		for (int c = 0; c < m && status == KNOT_TRUE; c++)
+		{
+			double complex in = cr[c].sign > 0 ? t : -1.0;
+			double complex out = cr[c].sign > 0 ? -1.0 : t;
+			if ((cr[c].over_arc < m && __row_add(&rows[c], cr[c].over_arc, 1.0 - t) != KNOT_TRUE)
+				|| (cr[c].in_arc < m && __row_add(&rows[c], cr[c].in_arc, in) != KNOT_TRUE)
+				|| (cr[c].out_arc < m && __row_add(&rows[c], cr[c].out_arc, out) != KNOT_TRUE))
+			{
+				status = KNOT_MALLOC_ERROR;
+			}
+		}
+		double complex det = 0.0;
+		if (status == KNOT_TRUE) status = __sparse_det(rows, m, &det);
+		if (status == KNOT_TRUE) *abs_delta = cabs(det);
+		for (int c = 0; rows && c < m; c++)
+		{
+			free(rows[c].cols);
+			free(rows[c].vals);
+		}
+		free(rows);
+	}
+	free(cr);
+	free(pts);
+	return status;
+}
+
+int knot_determinant(const Point3D chain[], int N, long *det)
+{
+	double abs_delta;
+	int status = knot_alexander(chain, N, -1.0, &abs_delta);
+	*det = lround(abs_delta);
+	return status;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static LatticePoint __perturbed_site(const Point3D *pt)
+{
+	LatticePoint site = lat_from_pt(pt);
+	uint64_t h = lat_key_hash(lat_key(&site));
+	int span = 2 * KNOT_JITTER + 1;
+	LatticePoint p;
+	p.x = KNOT_SCALE * site.x + (int32_t)(h % span) - KNOT_JITTER;
+	p.y = KNOT_SCALE * site.y + (int32_t)((h >> 21) % span) - KNOT_JITTER;
+	p.z = KNOT_SCALE * site.z + (int32_t)((h >> 42) % span) - KNOT_JITTER;
+	return p;
+}
+
+/*
+ * One sweep over the ring, dropping vertices whose triangle is empty; at most
+ * every other one goes, so a pass roughly halves the ring. The BVH is built
+ * once per pass; when vertex i goes, the box of segment p grows to take in q,
+ * so it still bounds the new segment p -> q.
+ */
+static int __kmt_pass(struct kmt *k, bool *removed)
+{
+	*removed = false;
+	int n = k->n;
+	for (int v = 0; v < n; v++)
+	{
+		k->pts[v] = lat_to_pt(&k->lat[v]);
+		k->prev[v] = v > 0 ? v - 1 : n - 1;
+		k->next[v] = v + 1 < n ? v + 1 : 0;
+		k->alive[v] = true;
+	}
+	SegBvh bvh;
+	if (bvh_build(&bvh, k->pts, n, true) != BVH_TRUE) return KNOT_MALLOC_ERROR;
+
+	int alive = n;
+	for (int i = 0; i < n && alive > 3; i++)
+	{
+		k->p = k->prev[i];
+		k->i = i;
+		k->q = k->next[i];
+		const LatticePoint *a = &k->lat[k->p], *b = &k->lat[i], *c = &k->lat[k->q];
+		int64_t ux = b->x - a->x, uy = b->y - a->y, uz = b->z - a->z;
+		int64_t vx = c->x - a->x, vy = c->y - a->y, vz = c->z - a->z;
+		bool flat = uy * vz - uz * vy == 0 && uz * vx - ux * vz == 0 && ux * vy - uy * vx == 0;
+		if (!flat)
+		{
+			// only a triangle with area can be crossed; a flat one just
+			// retraces the ring
+			const int32_t x[3][3] = {{a->x, a->y, a->z}, {b->x, b->y, b->z}, {c->x, c->y, c->z}};
+			float lo[3], hi[3];
+			for (int d = 0; d < 3; d++)
+			{
+				k->lo[d] = k->hi[d] = x[0][d];
+				for (int m = 1; m < 3; m++)
+				{
+					if (x[m][d] < k->lo[d]) k->lo[d] = x[m][d];
+					if (x[m][d] > k->hi[d]) k->hi[d] = x[m][d];
+				}
+				lo[d] = (float)k->lo[d];
+				hi[d] = (float)k->hi[d];
+			}
+			if (bvh_query(&bvh, lo, hi, __kmt_visit, k) == KMT_BLOCKED) continue;
+		}
+		k->alive[i] = false;
+		k->next[k->p] = k->q;
+		k->prev[k->q] = k->p;
+		bvh_expand(&bvh, k->p, &k->pts[k->q]);
+		alive--;
+		*removed = true;
+		// leave q for the next pass: its triangle would now reach back to p,
+		// and keeping triangles short keeps the BVH queries local
+		i++;
+	}
+	bvh_destroy(&bvh);
+
+	// compact the survivors, in ring order, for the next pass
+	int m = 0;
+	for (int v = 0; v < n; v++)
+	{
+		if (k->alive[v]) k->lat[m++] = k->lat[v];
+	}
+	k->n = m;
+	return KNOT_TRUE;
+}
+
+/* bvh_query visitor: does segment seg block removing the current vertex? */
+static int __kmt_visit(int seg, void *ctx)
+{
+	struct kmt *k = (struct kmt *)ctx;
+	if (!k->alive[seg] || seg == k->p || seg == k->i) return BVH_TRUE;
+
+	const LatticePoint *a = &k->lat[k->p], *b = &k->lat[k->i], *c = &k->lat[k->q];
+	const LatticePoint *s0 = &k->lat[seg], *s1 = &k->lat[k->next[seg]];
+	const int32_t x0[3] = {s0->x, s0->y, s0->z}, x1[3] = {s1->x, s1->y, s1->z};
+	for (int d = 0; d < 3; d++)
+	{
+		// the leaf box may be loose; the segment's own box is not
+		if ((x0[d] < k->lo[d] && x1[d] < k->lo[d]) || (x0[d] > k->hi[d] && x1[d] > k->hi[d]))
+		{
+			return BVH_TRUE;
+		}
+	}
+	if (seg == k->q || k->next[seg] == k->p)
+	{
+		// a neighbouring segment touches the triangle at its shared end; it
+		// can only reach further in if it lies in the triangle's plane
+		const LatticePoint *far = seg == k->q ? s1 : s0;
+		return __orient3d(a, b, c, far) == 0 ? KMT_BLOCKED : BVH_TRUE;
+	}
+	return __seg_hits_triangle(s0, s1, a, b, c) ? KMT_BLOCKED : BVH_TRUE;
+}
+
+/* sign of (b - a) . ((c - a) x (d - a)), exact for lattice coordinates */
+static inline int __orient3d(const LatticePoint *a, const LatticePoint *b,
+	const LatticePoint *c, const LatticePoint *d)
+{
+	int64_t ux = b->x - a->x, uy = b->y - a->y, uz = b->z - a->z;
+	int64_t vx = c->x - a->x, vy = c->y - a->y, vz = c->z - a->z;
+	int64_t wx = d->x - a->x, wy = d->y - a->y, wz = d->z - a->z;
+	__int128 det = (__int128)ux * (vy * wz - vz * wy)
+		+ (__int128)uy * (vz * wx - vx * wz)
+		+ (__int128)uz * (vx * wy - vy * wx);
+	return (det > 0) - (det < 0);
+}
+
+/* Whether s0 -> s1 meets triangle abc; touching and coplanar cases count */
+static bool __seg_hits_triangle(const LatticePoint *s0, const LatticePoint *s1,
+	const LatticePoint *a, const LatticePoint *b, const LatticePoint *c)
+{
+	int o0 = __orient3d(a, b, c, s0), o1 = __orient3d(a, b, c, s1);
+	if (o0 == o1) return o0 == 0; // same side, or conservatively coplanar
+	int e1 = __orient3d(s0, s1, a, b);
+	int e2 = __orient3d(s0, s1, b, c);
+	int e3 = __orient3d(s0, s1, c, a);
+	return (e1 >= 0 && e2 >= 0 && e3 >= 0) || (e1 <= 0 && e2 <= 0 && e3 <= 0);
+}
+
+/*
+ * Crossings of the ring pts[0 .. n - 1] seen along the z axis after one of
+ * NUM_PROJECTIONS fixed generic rotations. Returns KNOT_DEGENERATE if two
+ * segments cross at a vertex, overlap, or meet in space.
+ */
+static int __crossings(const Point3D pts[], int n, int projection,
+	struct crossing **out, int *num)
+{
+	static const double angles[NUM_PROJECTIONS][3] = {
+		{0.4142135, 0.7320508, 0.2360679},
+		{1.1892071, 0.5772156, 2.6457513},
+		{0.3010299, 1.6180339, 0.8660254},
+		{2.2360679, 0.1415926, 1.4142135}
+	};
+	const double *ang = angles[projection];
+	double ca = cos(ang[0]), sa = sin(ang[0]);
+	double cb = cos(ang[1]), sb = sin(ang[1]);
+	double cc = cos(ang[2]), sc = sin(ang[2]);
+	// R = Rz(a) Ry(b) Rx(c)
+	double R[3][3] = {
+		{ca * cb, ca * sb * sc - sa * cc, ca * sb * cc + sa * sc},
+		{sa * cb, sa * sb * sc + ca * cc, sa * sb * cc - ca * sc},
+		{-sb, cb * sc, cb * cc}
+	};
+	double (*r)[3] = (double (*)[3])malloc(n * sizeof(double[3]));
+	if (r == NULL) return KNOT_MALLOC_ERROR;
+	for (int v = 0; v < n; v++)
+	{
+		double x[3] = {pts[v].x, pts[v].y, pts[v].z};
+		for (int d = 0; d < 3; d++) r[v][d] = R[d][0] * x[0] + R[d][1] * x[1] + R[d][2] * x[2];
+	}
+
+	int cap = 16, count = 0;
+	struct crossing *cr = (struct crossing *)malloc(cap * sizeof(struct crossing));
+	int status = cr ? KNOT_TRUE : KNOT_MALLOC_ERROR;
+	for (int i = 0; i < n && status == KNOT_TRUE; i++)
+	{
+		const double *p0 = r[i], *p1 = r[(i + 1) % n];
+		double ex = p1[0] - p0[0], ey = p1[1] - p0[1];
+		for (int j = i + 2; j < n && status == KNOT_TRUE; j++)
+		{
+			if (i == 0 && j == n - 1) continue;
+			const double *q0 = r[j], *q1 = r[(j + 1) % n];
+			double fx = q1[0] - q0[0], fy = q1[1] - q0[1];
+			double gx = q0[0] - p0[0], gy = q0[1] - p0[1];
+			double den = ex * fy - ey * fx;
+			double scale = fabs(ex) + fabs(ey) + fabs(fx) + fabs(fy);
+			if (fabs(den) <= PARAM_EPS * scale * scale)
+			{
+				// parallel in projection: only a problem if they overlap
+				if (fabs(gx * ey - gy * ex) <= PARAM_EPS * scale * (fabs(gx) + fabs(gy) + 1.0))
+				{
+					status = KNOT_DEGENERATE;
+				}
+				continue;
+			}
+			double ti = (gx * fy - gy * fx) / den;
+			double tj = (gx * ey - gy * ex) / den;
+			if (ti < -PARAM_EPS || ti > 1.0 + PARAM_EPS || tj < -PARAM_EPS || tj > 1.0 + PARAM_EPS)
+			{
+				continue;
+			}
+			if (ti < PARAM_EPS || ti > 1.0 - PARAM_EPS || tj < PARAM_EPS || tj > 1.0 - PARAM_EPS)
+			{
+				status = KNOT_DEGENERATE;
+				continue;
+			}
+			double zi = p0[2] + ti * (p1[2] - p0[2]);
+			double zj = q0[2] + tj * (q1[2] - q0[2]);
+			if (fabs(zi - zj) <= HEIGHT_EPS)
+			{
+				status = KNOT_DEGENERATE;
+				continue;
+			}
+			if (count == cap)
+			{
+				cap *= 2;
+				struct crossing *grown = (struct crossing *)realloc(cr, cap * sizeof(struct crossing));
+				if (grown == NULL)
+				{
+					status = KNOT_MALLOC_ERROR;
+					continue;
+				}
+				cr = grown;
+			}
+			struct crossing *x = &cr[count++];
+			bool i_over = zi > zj;
+			x->over_seg = i_over ? i : j;
+			x->under_seg = i_over ? j : i;
+			x->over_t = i_over ? ti : tj;
+			x->under_t = i_over ? tj : ti;
+			// right-handed when the under strand runs clockwise of the over one
+			double turn = i_over ? den : -den;
+			x->sign = turn < 0.0 ? 1 : -1;
+		}
+	}
+	free(r);
+	if (status != KNOT_TRUE)
+	{
+		free(cr);
+		cr = NULL;
+		count = 0;
+	}
+	*out = cr;
+	*num = count;
+	return status;
+}
+
+static int __cmp_passage(const void *a, const void *b)
+{
+	const struct passage *pa = (const struct passage *)a, *pb = (const struct passage *)b;
+	if (pa->seg != pb->seg) return pa->seg - pb->seg;
+	return (pa->t > pb->t) - (pa->t < pb->t);
+}
+
+/*
+ * Number the arcs (stretches of the ring between undercrossings) and record
+ * at each crossing its over arc and the under arcs entering and leaving.
+ */
+static int __label_arcs(struct crossing *cr, int num)
+{
+	if (num == 0) return KNOT_TRUE;
+	struct passage *pass = (struct passage *)malloc(2 * num * sizeof(struct passage));
+	if (pass == NULL) return KNOT_MALLOC_ERROR;
+	for (int c = 0; c < num; c++)
+	{
+		pass[2 * c] = (struct passage){cr[c].over_seg, cr[c].over_t, c, false};
+		pass[2 * c + 1] = (struct passage){cr[c].under_seg, cr[c].under_t, c, true};
+	}
+	qsort(pass, 2 * num, sizeof(struct passage), __cmp_passage);
+
+	// arc a ends at the a-th undercrossing; anything after the last one is
+	// on arc 0 again
+	int arc = 0;
+	for (int e = 0; e < 2 * num; e++)
+	{
+		struct crossing *x = &cr[pass[e].crossing];
+		if (pass[e].under)
+		{
+			x->in_arc = arc;
+			arc = (arc + 1) % num;
+			x->out_arc = arc;
+		}
+		else
+		{
+			x->over_arc = arc;
+		}
+	}
+	free(pass);
+	return KNOT_TRUE;
+}
+
+/* Add val at column col, keeping the row sorted by column */
+static int __row_add(struct sparse_row *row, int col, double complex val)
+{
+	int pos = 0;
+	while (pos < row->len && row->cols[pos] < col) pos++;
+	if (pos < row->len && row->cols[pos] == col)
+	{
+		row->vals[pos] += val;
+		return KNOT_TRUE;
+	}
+	if (row->len == row->cap)
+	{
+		int cap = row->cap ? 2 * row->cap : 4;
+		int *cols = (int *)realloc(row->cols, cap * sizeof(int));
+		if (cols == NULL) return KNOT_MALLOC_ERROR;
+		row->cols = cols;
+		double complex *vals = (double complex *)realloc(row->vals, cap * sizeof(double complex));
+		if (vals == NULL) return KNOT_MALLOC_ERROR;
+		row->vals = vals;
+		row->cap = cap;
+	}
+	memmove(row->cols + pos + 1, row->cols + pos, (row->len - pos) * sizeof(int));
+	memmove(row->vals + pos + 1, row->vals + pos, (row->len - pos) * sizeof(double complex));
+	row->cols[pos] = col;
+	row->vals[pos] = val;
+	row->len++;
+	return KNOT_TRUE;
+}
+
+/*
+ * Determinant of the m x m matrix in rows by Gaussian elimination on sorted
+ * sparse rows. Column c is eliminated from the remaining rows that start at c,
+ * pivoting on the largest of them, so rows only ever lose leading columns and
+ * fill-in stays within the band the ring's arc order gives the matrix.
+ */
+static int __sparse_det(struct sparse_row *rows, int m, double complex *det)
+{
+	*det = 1.0;
+	bool *used = (bool *)calloc(m, sizeof(bool));
+	int *order = (int *)malloc(m * sizeof(int));
+	struct sparse_row scratch = {NULL, NULL, 0, 0};
+	int status = used && order ? KNOT_TRUE : KNOT_MALLOC_ERROR;
+
+	for (int c = 0; c < m && status == KNOT_TRUE; c++)
+	{
+		int pivot = -1;
+		double best = 0.0;
+		for (int r = 0; r < m; r++)
+		{
+			if (used[r] || rows[r].len == 0 || rows[r].cols[0] != c) continue;
+			double mag = cabs(rows[r].vals[0]);
+			if (mag > best)
+			{
+				best = mag;
+				pivot = r;
+			}
+		}
+		if (pivot < 0)
+		{
+			*det = 0.0;
+			break;
+		}
+		used[pivot] = true;
+		order[c] = pivot;
+		const struct sparse_row *pr = &rows[pivot];
+		double complex pv = pr->vals[0];
+		*det *= pv;
+
+		for (int r = 0; r < m && status == KNOT_TRUE; r++)
+		{
+			struct sparse_row *row = &rows[r];
+			if (used[r] || row->len == 0 || row->cols[0] != c) continue;
+			double complex factor = row->vals[0] / pv;
+			double scale = cabs(row->vals[0]);
+			// merge row[1..] - factor * pivot[1..] into scratch
+			scratch.len = 0;
+			int a = 1, b = 1;
+			while ((a < row->len || b < pr->len) && status == KNOT_TRUE)
+			{
+				int col;
+				double complex v;
+				if (b >= pr->len || (a < row->len && row->cols[a] < pr->cols[b]))
+				{
+					col = row->cols[a];
+					v = row->vals[a++];
+				}
+				else if (a >= row->len || pr->cols[b] < row->cols[a])
+				{
+					col = pr->cols[b];
+					v = -factor * pr->vals[b++];
+				}
+				else
+				{
+					col = row->cols[a];
+					v = row->vals[a++] - factor * pr->vals[b++];
+				}
+				if (cabs(v) > PIVOT_EPS * scale) status = __row_add(&scratch, col, v);
+			}
+			// swap the merged entries in, keeping both buffers for reuse
+			struct sparse_row tmp = *row;
+			*row = scratch;
+			scratch = tmp;
+		}
+	}
+
+	if (status == KNOT_TRUE && *det != 0.0)
+	{
+		// sign of the row permutation
+		for (int c = 0; c < m; c++)
+		{
+			while (order[c] != c)
+			{
+				int o = order[c];
+				order[c] = order[o];
+				order[o] = o;
+				*det = -*det;
+			}
+		}
+	}
+	free(scratch.cols);
+	free(scratch.vals);
+	free(used);
+	free(order);
+	return status;
+}
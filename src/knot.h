@@ -0,0 +1,68 @@
+#ifndef KNOT_H_
+#define KNOT_H_
+
+#include <complex.h>
+#include <stdbool.h>
+#include "point3d.h"
+
+#define KNOT_TRUE 0
+#define KNOT_MALLOC_ERROR -2
+#define KNOT_INVALID_CHAIN -6
+#define KNOT_DEGENERATE -11
+
+/*
+ * Knot typing of closed lattice chains.
+ *
+ * A ring is first shrunk with a KMT-style reduction (Koniaris & Muthukumar,
+ * PRL 66, 1991; Taylor, Nature 406, 2000): a vertex is dropped whenever the
+ * triangle it spans with its neighbours meets no other segment, which never
+ * changes the knot type. Triangle tests are exact integer predicates, and a
+ * segment BVH limits each test to nearby segments. About three in four
+ * 1000-step rings come down to a triangle, an unknot; the rest keep 6 to 16
+ * or so vertices.
+ *
+ * The reduced ring is then projected, its crossings turned into an Alexander
+ * matrix, and one minor's determinant evaluated at a given t with sparse
+ * elimination. That gives the Alexander polynomial Delta(t) up to a factor
+ * +-t^k; at a root of unity only |Delta(t)| is meaningful.
+ */
+
+/*  KMT-reduce the closed chain chain[0 .. N - 1] into out (room for N points);
+    *M receives the number of vertices kept. The chain must sit on distinct
+    integer sites. To put the ring in general position for the triangle and
+    crossing tests, every site is moved less than 0.05 in a fixed
+    pseudo-random direction first, and the kept vertices are returned at
+    those moved positions.
+
+    Returns:
+        KNOT_TRUE on success
+        KNOT_INVALID_CHAIN if N < 3
+        KNOT_MALLOC_ERROR if the working memory could not be allocated
+*/
+int knot_simplify(const Point3D chain[], int N, Point3D out[], int *M);
+
+/*  |Delta(t)| of the closed chain chain[0 .. N - 1], reducing it first
+
+    Returns:
+        KNOT_TRUE on success
+        KNOT_INVALID_CHAIN if N < 3
+        KNOT_DEGENERATE if no projection tried was generic, i.e. the chain
+            intersects itself
+        KNOT_MALLOC_ERROR if the working memory could not be allocated
+*/
+int knot_alexander(const Point3D chain[], int N, double complex t, double *abs_delta);
+
+/*
+ * The knot determinant |Delta(-1)|, an odd integer: 1 for the unknot, 3 for
+ * trefoils, 5 for the figure-eight and 5_1 knots, 7 for 5_2, and so on.
+ * Returns as knot_alexander.
+ */
+int knot_determinant(const Point3D chain[], int N, long *det);
+
+/* Cheap rejection test: any ring with a determinant other than 1 is knotted */
+static inline bool knot_is_knotted(long det)
+{
+	return det != 1;
+}
+
+#endif /* KNOT_H_ */
@@ -0,0 +1,159 @@
+#ifndef LATTICE_H_
+#define LATTICE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h> /* lrintf */
+#include "point3d.h"
+
+/*
+ * Exact integer lattice sites.
+ *
+ * Chains live on the integer lattice, so comparing their float coordinates
+ * with flt_near_eq is both slow and unnecessary. A LatticePoint holds the
+ * same site as three ints, and a LatticeKey packs it into one 64-bit word by
+ * interleaving the bits of the three (biased) coordinates in Morton order:
+ * two sites are equal iff their keys are, and sites close in space tend to
+ * have keys close in value.
+ *
+ * Each coordinate must lie in [LAT_COORD_MIN, LAT_COORD_MAX], i.e. about a
+ * million steps either side of the origin.
+ */
+
+#define LAT_COORD_BITS 21
+#define LAT_COORD_BIAS (INT32_C(1) << (LAT_COORD_BITS - 1))
+#define LAT_COORD_MIN (-LAT_COORD_BIAS)
+#define LAT_COORD_MAX (LAT_COORD_BIAS - 1)
+
+#define LAT_NUM_SYMMETRIES 48 /* signed permutations of the three axes */
+
+typedef struct lattice_pt LatticePoint;
+
+struct lattice_pt
+{
+	int32_t x;
+	int32_t y;
+	int32_t z;
+};
+
+typedef uint64_t LatticeKey;
+
+/* spread the low 21 bits of v so that bit i lands on bit 3i */
+static inline uint64_t lat_spread_bits(uint64_t v)
+{
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffffULL;
+	v = (v | v << 16) & 0x1f0000ff0000ffULL;
+	v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+	v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+	v = (v | v << 2)  & 0x1249249249249249ULL;
+	return v;
+}
+
+/* inverse of lat_spread_bits */
+static inline uint64_t lat_compact_bits(uint64_t v)
+{
+	v &= 0x1249249249249249ULL;
+	v = (v ^ (v >> 2))  & 0x10c30c30c30c30c3ULL;
+	v = (v ^ (v >> 4))  & 0x100f00f00f00f00fULL;
+	v = (v ^ (v >> 8))  & 0x1f0000ff0000ffULL;
+	v = (v ^ (v >> 16)) & 0x1f00000000ffffULL;
+	v = (v ^ (v >> 32)) & 0x1fffff;
+	return v;
+}
+
+static inline LatticeKey lat_key(const LatticePoint *p)
+{
+	return lat_spread_bits((uint64_t)(p->x + LAT_COORD_BIAS))
+		| lat_spread_bits((uint64_t)(p->y + LAT_COORD_BIAS)) << 1
+		| lat_spread_bits((uint64_t)(p->z + LAT_COORD_BIAS)) << 2;
+}
+
+static inline LatticePoint lat_from_key(LatticeKey key)
+{
+	LatticePoint p;
+	p.x = (int32_t)lat_compact_bits(key) - LAT_COORD_BIAS;
+	p.y = (int32_t)lat_compact_bits(key >> 1) - LAT_COORD_BIAS;
+	p.z = (int32_t)lat_compact_bits(key >> 2) - LAT_COORD_BIAS;
+	return p;
+}
+
+/* round a Point3D to the nearest lattice site */
+static inline LatticePoint lat_from_pt(const Point3D *pt)
+{
+	LatticePoint p;
+	p.x = (int32_t)lrintf(pt->x);
+	p.y = (int32_t)lrintf(pt->y);
+	p.z = (int32_t)lrintf(pt->z);
+	return p;
+}
+
+static inline Point3D lat_to_pt(const LatticePoint *p)
+{
+	Point3D pt;
+	pt.x = (float)p->x;
+	pt.y = (float)p->y;
+	pt.z = (float)p->z;
+	return pt;
+}
+
+static inline LatticeKey lat_key_from_pt(const Point3D *pt)
+{
+	LatticePoint p = lat_from_pt(pt);
+	return lat_key(&p);
+}
+
+static inline Point3D lat_key_to_pt(LatticeKey key)
+{
+	LatticePoint p = lat_from_key(key);
+	return lat_to_pt(&p);
+}
+
+static inline bool lat_equal(const LatticePoint *p_1, const LatticePoint *p_2)
+{
+	return p_1->x == p_2->x && p_1->y == p_2->y && p_1->z == p_2->z;
+}
+
+/* finalizer of splitmix64: a bijective mix of the key for hash tables */
+static inline uint64_t lat_key_hash(LatticeKey key)
+{
+	key ^= key >> 30;
+	key *= 0xBF58476D1CE4E5B9ULL;
+	key ^= key >> 27;
+	key *= 0x94D049BB133111EBULL;
+	key ^= key >> 31;
+	return key;
+}
+
+/*
+ * Symmetry g of the cube, in [0, LAT_NUM_SYMMETRIES), maps coordinate c of
+ * the image to coordinate lat_symmetry_perm(g)[c] of the point, negated if
+ * bit c of g % 8 is set. g = 0 is the identity.
+ */
+static inline const int *lat_symmetry_perm(int g)
+{
+	// the six permutations of (x, y, z); index 0 is the identity
+	static const int perms[6][3] = {
+		{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+	};
+	return perms[g / 8];
+}
+
+/* -1 if symmetry g negates coordinate c of the image, otherwise 1 */
+static inline int lat_symmetry_sign(int g, int c)
+{
+	return (g >> c) & 1 ? -1 : 1;
+}
+
+static inline Point3D lat_apply_symmetry(int g, const Point3D *v)
+{
+	const int *perm = lat_symmetry_perm(g);
+	const float coords[3] = {v->x, v->y, v->z};
+	Point3D image;
+	image.x = (g & 1) ? -coords[perm[0]] : coords[perm[0]];
+	image.y = (g & 2) ? -coords[perm[1]] : coords[perm[1]];
+	image.z = (g & 4) ? -coords[perm[2]] : coords[perm[2]];
+	return image;
+}
+
+#endif /* LATTICE_H_ */
@@ -0,0 +1,351 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "linking.h"
+#include "solid_angle.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * Tile shape for link_gauss. Rows of a tile share their solid_angle_block row
+ * buffers, and a column span of TILE_COLS keeps those buffers (8 doubles per
+ * column) inside L2.
+ */
+#define TILE_ROWS 64
+#define TILE_COLS 1024
+
+/* state shared by every worker of one link_gauss call */
+struct link_job
+{
+	const SegArray *a;
+	const SegArray *b;
+	int row_tiles;
+	int col_tiles;
+	int num_tiles;
+	double *tile_sums;
+	int next_tile; /* claimed with an atomic fetch-and-add */
+};
+
+/* a segment of chain a, filed under the (y, z) corner of its box */
+struct cell_entry
+{
+	uint64_t key;
+	int seg;
+};
+
+static void *__worker(void *arg);
+static LatticePoint *__to_lattice(const Point3D pts[], int N, int32_t scale,
+	const int32_t offset[3], int *status);
+static int __count_crossings(const LatticePoint *pa, int N, const LatticePoint *pb,
+	int M, int32_t scale, int *lk);
+static inline int32_t __cell(int32_t v, int32_t scale);
+static inline uint64_t __cell_key(int32_t y, int32_t z);
+static int __cmp_cell_entry(const void *a, const void *b);
+static inline int __lex_sign(int64_t x, int64_t y, int64_t z);
+static inline int __orient(const LatticePoint *a, const LatticePoint *b,
+	const LatticePoint *c);
+static int __crossing(const LatticePoint *p0, const LatticePoint *p1,
+	const LatticePoint *q0, const LatticePoint *q1);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int link_gauss(const Point3D a[], int N, const Point3D b[], int M,
+	int num_threads, double *lk)
+{
+	*lk = 0.0;
+	if (N <= 0 || M <= 0) return LINK_TRUE;
+
+	// chains in disjoint boxes are split by a plane, so cannot be linked
+	float lo_a[3], hi_a[3], lo_b[3], hi_b[3];
+	link_bounds(a, N, lo_a, hi_a);
+	link_bounds(b, M, lo_b, hi_b);
+	for (int k = 0; k < 3; k++)
+	{
+		if (lo_a[k] > hi_b[k] || lo_b[k] > hi_a[k]) return LINK_TRUE;
+	}
+
+	SegArray sa, sb;
+	if (seg_array_init(&sa, a, N) != SOLID_ANGLE_TRUE) return LINK_MALLOC_ERROR;
+	if (seg_array_init(&sb, b, M) != SOLID_ANGLE_TRUE)
+	{
+		seg_array_destroy(&sa);
+		return LINK_MALLOC_ERROR;
+	}
+
+	struct link_job job = {
+		.a         = &sa,
+		.b         = &sb,
+		.row_tiles = (N + TILE_ROWS - 1) / TILE_ROWS,
+		.col_tiles = (M + TILE_COLS - 1) / TILE_COLS,
+		.next_tile = 0
+	};
+	job.num_tiles = job.row_tiles * job.col_tiles;
+	job.tile_sums = (double *)malloc(job.num_tiles * sizeof(double));
+	int status = job.tile_sums ? LINK_TRUE : LINK_MALLOC_ERROR;
+
+	if (num_threads > job.num_tiles) num_threads = job.num_tiles;
+	pthread_t *threads = NULL;
+	int started = 0;
+	if (status == LINK_TRUE && num_threads > 1)
+	{
+		threads = (pthread_t *)malloc((num_threads - 1) * sizeof(pthread_t));
+		for (; threads && started < num_threads - 1; started++)
+		{
+			if (pthread_create(&threads[started], NULL, __worker, &job) != 0) break;
+		}
+	}
+	if (status == LINK_TRUE)
+	{
+		// the calling thread works too; tiles are claimed dynamically, so any
+		// thread that fails to start or allocate is simply covered by the rest
+		__worker(&job);
+		for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+		if (job.next_tile < job.num_tiles) status = LINK_MALLOC_ERROR;
+	}
+	free(threads);
+
+	if (status == LINK_TRUE)
+	{
+		double sum = 0.0;
+		for (int t = 0; t < job.num_tiles; t++) sum += job.tile_sums[t];
+		*lk = sum / (4.0 * M_PI);
+	}
+	free(job.tile_sums);
+	seg_array_destroy(&sa);
+	seg_array_destroy(&sb);
+	return status;
+}
+
+int link_crossings(const Point3D a[], int N, const Point3D b[], int M, int *lk)
+{
+	static const int32_t no_offset[3] = {0, 0, 0};
+	*lk = 0;
+	if (N <= 0 || M <= 0) return LINK_TRUE;
+
+	int status = LINK_TRUE;
+	LatticePoint *pa = __to_lattice(a, N, 1, no_offset, &status);
+	LatticePoint *pb = status == LINK_TRUE ? __to_lattice(b, M, 1, no_offset, &status) : NULL;
+	if (status == LINK_TRUE) status = __count_crossings(pa, N, pb, M, 1, lk);
+	free(pa);
+	free(pb);
+	return status;
+}
+
+int link_crossings_shifted(const Point3D a[], int N, const Point3D b[], int M,
+	const double shift[3], int *lk)
+{
+	static const int32_t no_offset[3] = {0, 0, 0};
+	*lk = 0;
+	if (N <= 0 || M <= 0) return LINK_TRUE;
+
+	// in quarter-lattice units every coordinate, and the shift, is an integer
+	int32_t offset[3];
+	for (int k = 0; k < 3; k++) offset[k] = (int32_t)lrint(LINK_SHIFT_SCALE * shift[k]);
+	int status = LINK_TRUE;
+	LatticePoint *pa = __to_lattice(a, N, LINK_SHIFT_SCALE, no_offset, &status);
+	LatticePoint *pb = status == LINK_TRUE
+		? __to_lattice(b, M, LINK_SHIFT_SCALE, offset, &status) : NULL;
+	if (status == LINK_TRUE) status = __count_crossings(pa, N, pb, M, LINK_SHIFT_SCALE, lk);
+	free(pa);
+	free(pb);
+	return status;
+}
+
+void link_bounds(const Point3D pts[], int N, float lo[3], float hi[3])
+{
+	lo[0] = hi[0] = pts[0].x;
+	lo[1] = hi[1] = pts[0].y;
+	lo[2] = hi[2] = pts[0].z;
+	for (int i = 1; i < N; i++)
+	{
+		float c[3] = {pts[i].x, pts[i].y, pts[i].z};
+		for (int k = 0; k < 3; k++)
+		{
+			if (c[k] < lo[k]) lo[k] = c[k];
+			if (c[k] > hi[k]) hi[k] = c[k];
+		}
+	}
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static void *__worker(void *arg)
+{
+	struct link_job *job = (struct link_job *)arg;
+	int cols = job->b->n < TILE_COLS ? job->b->n : TILE_COLS;
+	double *work = (double *)malloc(solid_angle_work_len(cols) * sizeof(double));
+	if (work == NULL) return NULL;
+
+	for (;;)
+	{
+		int t = __sync_fetch_and_add(&job->next_tile, 1);
+		if (t >= job->num_tiles) break;
+		int i0 = (t / job->col_tiles) * TILE_ROWS;
+		int j0 = (t % job->col_tiles) * TILE_COLS;
+		int i1 = i0 + TILE_ROWS < job->a->n ? i0 + TILE_ROWS : job->a->n;
+		int j1 = j0 + TILE_COLS < job->b->n ? j0 + TILE_COLS : job->b->n;
+		job->tile_sums[t] = solid_angle_block(job->a, i0, i1, job->b, j0, j1, work);
+	}
+	free(work);
+	return NULL;
+}
+
+/* Sites of pts scaled by scale and moved by offset, with steps checked */
+static LatticePoint *__to_lattice(const Point3D pts[], int N, int32_t scale,
+	const int32_t offset[3], int *status)
+{
+	LatticePoint *lat = (LatticePoint *)malloc(N * sizeof(LatticePoint));
+	if (lat == NULL)
+	{
+		*status = LINK_MALLOC_ERROR;
+		return NULL;
+	}
+	for (int i = 0; i < N; i++) lat[i] = lat_from_pt(&pts[i]);
+	for (int i = 0; i < N; i++)
+	{
+		const LatticePoint *p0 = &lat[i], *p1 = &lat[(i + 1) % N];
+		if (abs(p1->x - p0->x) > 1 || abs(p1->y - p0->y) > 1 || abs(p1->z - p0->z) > 1)
+		{
+			free(lat);
+			*status = LINK_INVALID_CHAIN;
+			return NULL;
+		}
+	}
+	if (scale != 1 || offset[0] || offset[1] || offset[2])
+	{
+		for (int i = 0; i < N; i++)
+		{
+			lat[i].x = scale * lat[i].x + offset[0];
+			lat[i].y = scale * lat[i].y + offset[1];
+			lat[i].z = scale * lat[i].z + offset[2];
+		}
+	}
+	return lat;
+}
+
+/*
+ * Signed count of crossings where pa passes over pb, for chains with steps of
+ * at most scale along each axis
+ */
+static int __count_crossings(const LatticePoint *pa, int N, const LatticePoint *pb,
+	int M, int32_t scale, int *lk)
+{
+	struct cell_entry *cells = (struct cell_entry *)malloc(N * sizeof(struct cell_entry));
+	if (cells == NULL) return LINK_MALLOC_ERROR;
+	for (int i = 0; i < N; i++)
+	{
+		const LatticePoint *p0 = &pa[i], *p1 = &pa[(i + 1) % N];
+		cells[i].key = __cell_key(__cell(p0->y < p1->y ? p0->y : p1->y, scale),
+			__cell(p0->z < p1->z ? p0->z : p1->z, scale));
+		cells[i].seg = i;
+	}
+	qsort(cells, N, sizeof(struct cell_entry), __cmp_cell_entry);
+
+	int status = LINK_TRUE;
+	int sum = 0;
+	for (int j = 0; j < M && status == LINK_TRUE; j++)
+	{
+		const LatticePoint *q0 = &pb[j], *q1 = &pb[(j + 1) % M];
+		int32_t y = __cell(q0->y < q1->y ? q0->y : q1->y, scale);
+		int32_t z = __cell(q0->z < q1->z ? q0->z : q1->z, scale);
+		// boxes of side scale overlap only if their corners' cells differ by
+		// at most 1
+		for (int dy = -1; dy <= 1 && status == LINK_TRUE; dy++)
+		{
+			for (int dz = -1; dz <= 1 && status == LINK_TRUE; dz++)
+			{
+				uint64_t key = __cell_key(y + dy, z + dz);
+				int lo = 0, hi = N;
+				while (lo < hi)
+				{
+					int mid = lo + (hi - lo) / 2;
+					if (cells[mid].key < key) lo = mid + 1;
+					else hi = mid;
+				}
+				for (int c = lo; c < N && cells[c].key == key; c++)
+				{
+					int i = cells[c].seg;
+					int crossing = __crossing(&pa[i], &pa[(i + 1) % N], q0, q1);
+					if (crossing == LINK_INTERSECTING) status = LINK_INTERSECTING;
+					else sum += crossing;
+				}
+			}
+		}
+	}
+	if (status == LINK_TRUE) *lk = sum;
+	free(cells);
+	return status;
+}
+
+/* floor(v / scale) */
+static inline int32_t __cell(int32_t v, int32_t scale)
+{
+	return v >= 0 ? v / scale : -((-v + scale - 1) / scale);
+}
+
+static inline uint64_t __cell_key(int32_t y, int32_t z)
+{
+	return ((uint64_t)(uint32_t)y << 32) | (uint32_t)z;
+}
+
+static int __cmp_cell_entry(const void *a, const void *b)
+{
+	uint64_t ka = ((const struct cell_entry *)a)->key;
+	uint64_t kb = ((const struct cell_entry *)b)->key;
+	return (ka > kb) - (ka < kb);
+}
+
+/* sign of (x, y, z) . d, i.e. of its first nonzero component */
+static inline int __lex_sign(int64_t x, int64_t y, int64_t z)
+{
+	if (x) return x > 0 ? 1 : -1;
+	if (y) return y > 0 ? 1 : -1;
+	return (z > 0) - (z < 0);
+}
+
+/* orientation of the projections of a, b, c: sign of ((b - a) x (c - a)) . d */
+static inline int __orient(const LatticePoint *a, const LatticePoint *b,
+	const LatticePoint *c)
+{
+	int64_t ux = b->x - a->x, uy = b->y - a->y, uz = b->z - a->z;
+	int64_t vx = c->x - a->x, vy = c->y - a->y, vz = c->z - a->z;
+	return __lex_sign(uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx);
+}
+
+/*
+ * Contribution of segments p0 -> p1 (chain a) and q0 -> q1 (chain b): the
+ * crossing sign if their projections cross with a on top, else 0, or
+ * LINK_INTERSECTING if they meet in space.
+ *
+ * A zero orientation means three of the points are collinear in space; with
+ * lattice vertices that cannot put a vertex inside the other segment, so only
+ * shared endpoints need checking and every other crossing is proper.
+ */
+static int __crossing(const LatticePoint *p0, const LatticePoint *p1,
+	const LatticePoint *q0, const LatticePoint *q1)
+{
+	if (lat_equal(p0, q0) || lat_equal(p0, q1) || lat_equal(p1, q0) || lat_equal(p1, q1))
+	{
+		return LINK_INTERSECTING;
+	}
+	int o1 = __orient(p0, p1, q0), o2 = __orient(p0, p1, q1);
+	if (o1 == 0 || o2 == 0 || o1 == o2) return 0;
+	int o3 = __orient(q0, q1, p0), o4 = __orient(q0, q1, p1);
+	if (o3 == 0 || o4 == 0 || o3 == o4) return 0;
+
+	// with e = p1 - p0, f = q1 - q0 and the crossing points X_a - X_b = h d,
+	// (p0 - q0) . (e x f) = h (d . (e x f)), which gives the side a is on
+	int64_t ex = p1->x - p0->x, ey = p1->y - p0->y, ez = p1->z - p0->z;
+	int64_t fx = q1->x - q0->x, fy = q1->y - q0->y, fz = q1->z - q0->z;
+	int64_t nx = ey * fz - ez * fy, ny = ez * fx - ex * fz, nz = ex * fy - ey * fx;
+	int64_t gap = (int64_t)(p0->x - q0->x) * nx + (int64_t)(p0->y - q0->y) * ny
+		+ (int64_t)(p0->z - q0->z) * nz;
+	if (gap == 0) return LINK_INTERSECTING;
+	int sign = __lex_sign(nx, ny, nz);
+	return (gap > 0) == (sign > 0) ? sign : 0;
+}
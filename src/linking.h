@@ -0,0 +1,82 @@
+#ifndef LINKING_H_
+#define LINKING_H_
+
+#include <math.h>
+#include "point3d.h"
+#include "lattice.h"
+
+#define LINK_TRUE 0
+#define LINK_MALLOC_ERROR -2
+#define LINK_INVALID_CHAIN -6
+#define LINK_INTERSECTING -10
+
+#define LINK_SHIFT_SCALE 4 /* link_crossings_shifted works in quarter steps */
+
+/*
+ * Linking numbers of pairs of closed chains.
+ *
+ * A chain of N monomers is the closed polygon through chain[0 .. N - 1] and
+ * back to chain[0], as built by generate_closed_chain.
+ */
+
+/*  Gauss linking number of closed chains a (N monomers) and b (M monomers)
+
+    Sums the exact segment-pair solid angles of solid_angle.h over all N * M
+    pairs, in tiles spread over num_threads threads (<= 0 means one). Tile sums
+    are added in a fixed order, so *lk does not depend on num_threads. For
+    chains that do not intersect *lk is within rounding of an integer.
+
+    Returns:
+        LINK_TRUE on success
+        LINK_MALLOC_ERROR if the chains or the workers' scratch could not be
+            allocated
+*/
+int link_gauss(const Point3D a[], int N, const Point3D b[], int M,
+	int num_threads, double *lk);
+
+/* The integer nearest a linking number from link_gauss */
+static inline int link_round(double lk)
+{
+	return (int)lrint(lk);
+}
+
+/*  Exact linking number of closed lattice chains a and b from their crossings
+
+    The chains are projected along d = (1, eps, eps^2) for an infinitesimal
+    eps. That direction is generic: every 2D orientation test becomes the
+    lexicographic sign of an integer cross product, so no projection is ever
+    degenerate and all predicates are exact in 64-bit integers. Segments of a
+    are bucketed by the lower corner of their (y, z) box; each segment of b
+    only meets the 9 buckets around its own. *lk is the signed count of
+    crossings where a passes over b. The cost is O((N + M) log N + K) for K
+    candidate pairs, which is about N + M for random rings.
+
+    Both chains must sit on integer sites with steps of at most 1 along each
+    axis, as chains of gen_all_bin_list3 steps do.
+
+    Returns:
+        LINK_TRUE on success
+        LINK_INVALID_CHAIN if a step of either chain is longer than that
+        LINK_INTERSECTING if the chains share a point, so have no linking
+            number
+        LINK_MALLOC_ERROR if the buckets could not be allocated
+*/
+int link_crossings(const Point3D a[], int N, const Point3D b[], int M, int *lk);
+
+/*
+ * link_crossings of a against b moved by shift, a multiple of
+ * 1 / LINK_SHIFT_SCALE along each axis (it is rounded to one). A shift of
+ * (1/2, 1/4, 0) plus any integer vector puts the sites and bonds of b off
+ * those of a for any two chains of gen_all_bin_list3 steps, so such pairs
+ * never intersect however they overlap. Returns as link_crossings.
+ */
+int link_crossings_shifted(const Point3D a[], int N, const Point3D b[], int M,
+	const double shift[3], int *lk);
+
+/*
+ * Bounding box [lo, hi] of pts[0 .. N - 1], N >= 1. Chains whose boxes are
+ * apart are split by a plane, so their linking number is 0.
+ */
+void link_bounds(const Point3D pts[], int N, float lo[3], float hi[3]);
+
+#endif /* LINKING_H_ */
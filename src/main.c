@@ -1,14 +1,30 @@
+#define _POSIX_C_SOURCE 200809L /* SIGUSR1 */
 //#include "chain.h"
 
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "gui.h"
+#include "study.h"
+#include "melt.h"
 
 #define NUM_DIRS 8
 #define DIM 3
 #define CHAIN_LEN 150 
+#define CHECKPOINT_SECS 60
 
+static volatile sig_atomic_t flush_requested = 0;
+
+static int __study_main(int argc, char *argv[]);
+static int __melt_main(int argc, char *argv[]);
+static void __request_flush(int sig);
 
 int main(int argc, char *argv[]) 
 {
+	if (argc > 1 && strcmp(argv[1], "study") == 0) return __study_main(argc - 1, argv + 1);
+	if (argc > 1 && strcmp(argv[1], "melt") == 0) return __melt_main(argc - 1, argv + 1);
+
 	//// initialize the random seed
 	//threefry2x32_ctr_t ctr = {{0, 0}};
 	//threefry2x32_key_t key = {{0, 0}};
@@ -27,3 +43,161 @@ int main(int argc, char *argv[])
 	return (gui_init(&argc, &argv) && gui_run()) ? 0 : 1;
 }
 
+
+
+/*
+ * study [-c CHECKPOINT] N PAIRS SEP[,SEP...] [THREADS [SEED [FLUSH_EVERY [POOL_FILE]]]]
+ *
+ * Runs the linking-probability study headless and streams the histograms to
+ * stdout every FLUSH_EVERY pairs, whenever the process gets SIGUSR1, and at
+ * the end. With POOL_FILE, an ensemble file of N-monomer rings, the pairs are
+ * symmetry-transformed copies of its rings instead of fresh ones. With
+ * -c the run checkpoints to CHECKPOINT every CHECKPOINT_SECS seconds and on
+ * every flush, and picks up from it when restarted with the same arguments.
+ */
+static int __study_main(int argc, char *argv[])
+{
+	const char *checkpoint = NULL;
+	if (argc > 2 && strcmp(argv[1], "-c") == 0)
+	{
+		checkpoint = argv[2];
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 4)
+	{
+		fprintf(stderr, "usage: study [-c CHECKPOINT] N PAIRS SEP[,SEP...] [THREADS [SEED [FLUSH_EVERY [POOL_FILE]]]]\n");
+		return 1;
+	}
+
+	int num_seps = 1;
+	for (const char *c = argv[3]; *c; c++) num_seps += *c == ',';
+	double *seps = (double *)malloc(num_seps * sizeof(double));
+	if (seps == NULL) return 1;
+	char *pos = argv[3];
+	for (int s = 0; s < num_seps; s++)
+	{
+		seps[s] = strtod(pos, &pos);
+		if (*pos == ',') pos++;
+	}
+
+	StudyParams params = {
+		.N               = atoi(argv[1]),
+		.num_pairs       = atoi(argv[2]),
+		.separations     = seps,
+		.num_separations = num_seps,
+		.num_threads     = argc > 4 ? atoi(argv[4]) : 1,
+		.queue_len       = 0,
+		.seed            = argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 10) : 0,
+		.flush           = study_flush_fprint,
+		.flush_ctx       = stdout,
+		.flush_every     = argc > 6 ? atol(argv[6]) : 0,
+		.flush_request   = &flush_requested,
+		.checkpoint      = checkpoint,
+		.checkpoint_secs = CHECKPOINT_SECS
+	};
+	ChainPool pool;
+	if (argc > 7)
+	{
+		int status = pool_load(&pool, argv[7]);
+		if (status != POOL_TRUE)
+		{
+			fprintf(stderr, "could not load pool %s (%d)\n", argv[7], status);
+			free(seps);
+			return 1;
+		}
+		params.pool = &pool;
+	}
+	// sigaction rather than signal, which under _POSIX_C_SOURCE resets the
+	// handler after the first SIGUSR1 so a second one would kill the run
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = __request_flush;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGUSR1, &action, NULL);
+
+	Point3D dirs[NUM_DIRS];
+	gen_all_bin_list3(dirs, NUM_DIRS);
+	StudyHist hist;
+	int status = study_hist_init(&hist, seps, num_seps);
+	if (status == STUDY_TRUE) status = study_run(&params, &hist, dirs, NUM_DIRS, DIM);
+	if (status != STUDY_TRUE) fprintf(stderr, "study failed (%d)\n", status);
+	study_hist_destroy(&hist);
+	if (params.pool) pool_destroy(&pool);
+	free(seps);
+	return status == STUDY_TRUE ? 0 : 1;
+}
+
+/*
+ * melt N RINGS BOX [THREADS [SEED [OUT_FILE [MAX_ATTEMPTS]]]]
+ *
+ * Grows RINGS closed rings of N monomers in a periodic box of side BOX,
+ * prints the attempts they took and the histogram of linking numbers over
+ * all pairs of rings (each summed over the periodic images of the other),
+ * and with OUT_FILE (other than "-") writes the rings to an ensemble file.
+ * Each ring gets MAX_ATTEMPTS tries, MELT_DEFAULT_ATTEMPTS by default, before
+ * the melt is given up.
+ */
+static int __melt_main(int argc, char *argv[])
+{
+	if (argc < 4)
+	{
+		fprintf(stderr, "usage: melt N RINGS BOX [THREADS [SEED [OUT_FILE [MAX_ATTEMPTS]]]]\n");
+		return 1;
+	}
+	MeltParams params = {
+		.N            = atoi(argv[1]),
+		.num_chains   = atoi(argv[2]),
+		.box          = atoi(argv[3]),
+		.num_threads  = argc > 4 ? atoi(argv[4]) : 1,
+		.max_attempts = argc > 7 ? atoi(argv[7]) : MELT_DEFAULT_ATTEMPTS,
+		.seed         = argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 10) : 0
+	};
+	Point3D dirs[NUM_DIRS];
+	gen_all_bin_list3(dirs, NUM_DIRS);
+	Melt melt;
+	int status = melt_generate(&melt, &params, dirs, NUM_DIRS, DIM);
+
+	long attempts = 0;
+	long counts[STUDY_NUM_BINS] = {0};
+	for (int k = 0; k < melt.num_chains && status == MELT_TRUE; k++) attempts += melt.attempts[k];
+	for (int a = 0; a < melt.num_chains && status == MELT_TRUE; a++)
+	{
+		for (int b = a + 1; b < melt.num_chains; b++)
+		{
+			int lk;
+			int link_status = melt_link(&melt, a, b, &lk);
+			if (link_status != LINK_TRUE)
+			{
+				fprintf(stderr, "could not link rings %d and %d (%d)\n", a, b, link_status);
+				status = MELT_FALSE;
+				break;
+			}
+			if (lk < -STUDY_MAX_LK) lk = -STUDY_MAX_LK;
+			if (lk > STUDY_MAX_LK) lk = STUDY_MAX_LK;
+			counts[lk + STUDY_MAX_LK]++;
+		}
+	}
+	if (status == MELT_TRUE)
+	{
+		printf("rings %d, attempts %ld, pairs %ld\nlk", melt.num_chains, attempts,
+			(long)melt.num_chains * (melt.num_chains - 1) / 2);
+		for (int lk = -STUDY_MAX_LK; lk <= STUDY_MAX_LK; lk++) printf(" %ld", counts[lk + STUDY_MAX_LK]);
+		printf("\n");
+	}
+	if (status == MELT_TRUE && argc > 6 && strcmp(argv[6], "-") != 0
+		&& melt_write(&melt, argv[6], params.seed) != ENS_FILE_TRUE)
+	{
+		fprintf(stderr, "could not write %s\n", argv[6]);
+		status = MELT_FALSE;
+	}
+	if (status != MELT_TRUE) fprintf(stderr, "melt failed (%d)\n", status);
+	melt_destroy(&melt);
+	return status == MELT_TRUE ? 0 : 1;
+}
+
+static void __request_flush(int sig)
+{
+	(void)sig;
+	flush_requested = 1;
+}
@@ -0,0 +1,306 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "melt.h"
+#include "rng.h"
+
+/* state shared by every worker of one melt_generate call */
+struct melt_job
+{
+	Melt *melt;
+	const MeltParams *params;
+	Point3D *dirs;
+	int dirs_len;
+	int dim;
+	int next_chain; /* claimed with an atomic fetch-and-add */
+	int tried;      /* rings grown or given up on, counted the same way */
+	int failed;     /* rings given up on after max_attempts */
+};
+
+/* PRIVATE FUNCTIONS */
+static void *__worker(void *arg);
+static bool __grow_ring(struct melt_job *job, int k, int attempt,
+	threefry2x32_key_t key, uint64_t claimed[]);
+static uint64_t __cell(const Melt *melt, const Point3D *p);
+static bool __cell_free(const Melt *melt, uint64_t cell);
+static bool __claim(Melt *melt, uint64_t cell, uint32_t owner);
+static void __release(Melt *melt, const uint64_t claimed[], int num_claimed);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int melt_generate(Melt *melt, const MeltParams *params,
+	Point3D dirs[], int dirs_len, int dim)
+{
+	melt->N = params->N;
+	melt->num_chains = params->num_chains;
+	melt->box = params->box;
+	melt->chains = NULL;
+	melt->attempts = NULL;
+	melt->cells = NULL;
+	// a box of side L holds L^3 / 4 sites, half on each sublattice
+	uint64_t box = params->box > 0 ? (uint64_t)params->box : 0;
+	if (params->N < 4 || params->N % 2 != 0 || params->num_chains < 0
+		|| box < 2 || box % 2 != 0
+		|| (uint64_t)params->N * (uint64_t)params->num_chains > box * box * box / 4 / MELT_MAX_FILL)
+	{
+		return MELT_INVALID_PARAMS;
+	}
+
+	melt->chains = (Point3D *)calloc((size_t)params->num_chains * params->N, sizeof(Point3D));
+	melt->attempts = (int *)calloc(params->num_chains > 0 ? params->num_chains : 1, sizeof(int));
+	melt->cells = (uint32_t *)calloc(box * box * box, sizeof(uint32_t));
+	if (melt->chains == NULL || melt->attempts == NULL || melt->cells == NULL)
+	{
+		melt_destroy(melt);
+		return MELT_MALLOC_ERROR;
+	}
+
+	struct melt_job job = {
+		.melt       = melt,
+		.params     = params,
+		.dirs       = dirs,
+		.dirs_len   = dirs_len,
+		.dim        = dim,
+		.next_chain = 0,
+		.tried      = 0,
+		.failed     = 0
+	};
+	int num_threads = params->num_threads > 0 ? params->num_threads : 1;
+	if (num_threads > params->num_chains) num_threads = params->num_chains;
+	if (num_threads <= 1)
+	{
+		__worker(&job);
+	}
+	else
+	{
+		pthread_t *threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+		if (threads == NULL)
+		{
+			melt_destroy(melt);
+			return MELT_MALLOC_ERROR;
+		}
+		int started = 0;
+		for (; started < num_threads; started++)
+		{
+			if (pthread_create(&threads[started], NULL, __worker, &job) != 0) break;
+		}
+		if (started == 0) __worker(&job);
+		for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+		free(threads);
+	}
+	// a worker that could not allocate tries no rings and leaves them to the
+	// others, so only rings nobody tried are an allocation failure
+	if (job.tried < params->num_chains)
+	{
+		melt_destroy(melt);
+		return MELT_MALLOC_ERROR;
+	}
+	return job.failed > 0 ? MELT_FALSE : MELT_TRUE;
+}
+
+void melt_destroy(Melt *melt)
+{
+	free(melt->chains);
+	free(melt->attempts);
+	free(melt->cells);
+	melt->chains = NULL;
+	melt->attempts = NULL;
+	melt->cells = NULL;
+	melt->num_chains = 0;
+}
+
+int melt_link(const Melt *melt, int a, int b, int *lk)
+{
+	const Point3D *ring_a = melt_ring(melt, a);
+	const Point3D *ring_b = melt_ring(melt, b);
+	float lo_a[3], hi_a[3], lo_b[3], hi_b[3];
+	link_bounds(ring_a, melt->N, lo_a, hi_a);
+	link_bounds(ring_b, melt->N, lo_b, hi_b);
+
+	// a ring can span more than half the box, so more than one image of b
+	// may reach into a's box; the images whose boxes are apart from it are
+	// split from a by a plane and add nothing
+	int first[3], last[3];
+	for (int c = 0; c < 3; c++)
+	{
+		first[c] = (int)ceilf((lo_a[c] - hi_b[c]) / melt->box);
+		last[c] = (int)floorf((hi_a[c] - lo_b[c]) / melt->box);
+	}
+	*lk = 0;
+	for (int x = first[0]; x <= last[0]; x++)
+	{
+		for (int y = first[1]; y <= last[1]; y++)
+		{
+			for (int z = first[2]; z <= last[2]; z++)
+			{
+				// sites are exclusive across images, and bonds meet only at
+				// shared sites, so the rings never touch and the crossings
+				// are well defined
+				double shift[3] = {(double)x * melt->box, (double)y * melt->box, (double)z * melt->box};
+				int image_lk;
+				int status = link_crossings_shifted(ring_a, melt->N, ring_b, melt->N, shift, &image_lk);
+				if (status != LINK_TRUE) return status;
+				*lk += image_lk;
+			}
+		}
+	}
+	return LINK_TRUE;
+}
+
+int melt_write(const Melt *melt, const char *path, uint32_t seed)
+{
+	EnsHeader header;
+	ens_header_init(&header, (uint32_t)melt->N, seed);
+	header.box = (uint32_t)melt->box;
+	EnsWriter writer;
+	int status = ens_writer_open(&writer, path, &header);
+	if (status != ENS_FILE_TRUE) return status;
+	for (int k = 0; k < melt->num_chains && status == ENS_FILE_TRUE; k++)
+	{
+		if (melt->attempts[k] > 0) status = ens_writer_add(&writer, melt_ring(melt, k), melt->N);
+	}
+	int close_status = ens_writer_close(&writer);
+	return status != ENS_FILE_TRUE ? status : close_status;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static void *__worker(void *arg)
+{
+	struct melt_job *job = (struct melt_job *)arg;
+
+	// the cells one attempt holds: one site per monomer
+	uint64_t *claimed = (uint64_t *)malloc((size_t)job->params->N * sizeof(uint64_t));
+	if (claimed == NULL) return NULL;
+
+	int k;
+	while ((k = __sync_fetch_and_add(&job->next_chain, 1)) < job->params->num_chains)
+	{
+		threefry2x32_ctr_t ctr;
+		threefry2x32_key_t key;
+		ensemble_stream(job->params->seed, k, &ctr, &key);
+		int max_attempts = job->params->max_attempts > 0 ? job->params->max_attempts : MELT_DEFAULT_ATTEMPTS;
+		for (int attempt = 0; attempt < max_attempts; attempt++)
+		{
+			if (__grow_ring(job, k, attempt, key, claimed))
+			{
+				job->melt->attempts[k] = attempt + 1;
+				break;
+			}
+		}
+		if (job->melt->attempts[k] == 0) __sync_fetch_and_add(&job->failed, 1);
+		__sync_fetch_and_add(&job->tried, 1);
+	}
+	free(claimed);
+	return NULL;
+}
+
+/*
+ * One attempt at ring k: the worm of generate_chain_worm, taking a neighbour
+ * only if its site is free, then claiming it.
+ * Returns false, with every claim released, if the walk is locked out, loses
+ * a claim, or fails to close.
+ */
+static bool __grow_ring(struct melt_job *job, int k, int attempt,
+	threefry2x32_key_t key, uint64_t claimed[])
+{
+	Melt *melt = job->melt;
+	int N = melt->N, dirs_len = job->dirs_len;
+	Point3D *dirs = job->dirs;
+	Point3D *ring = melt->chains + (size_t)k * N;
+	uint32_t owner = (uint32_t)k + 1;
+	int num_claimed = 0;
+
+	// a uniform site of either sublattice
+	RngStream rng;
+	threefry2x32_ctr_t ctr = {{0, ENS_AUX_STREAM | (uint32_t)attempt}};
+	rng_init(&rng, ctr, key);
+	uint32_t half = (uint32_t)melt->box / 2, parity = rng_below(&rng, 2);
+	Point3D start;
+	start.x = (float)(2 * rng_below(&rng, half) + parity);
+	start.y = (float)(2 * rng_below(&rng, half) + parity);
+	start.z = (float)(2 * rng_below(&rng, half) + parity);
+	ring[0] = start;
+	claimed[num_claimed] = __cell(melt, &start);
+	if (!__claim(melt, claimed[num_claimed], owner)) return false;
+	num_claimed++;
+
+	// the walk runs relative to start, where special_prob_dist wants it
+	Point3D node;
+	pt_init(&node);
+	ctr.v[1] = (uint32_t)attempt;
+	rng_init(&rng, ctr, key);
+	bool grown = true;
+	for (int i = 1; i < N && grown; i++)
+	{
+		uint32_t u_dir = rng_u32(&rng);
+		uint32_t u_free = rng_u32(&rng);
+
+		const Point3D *from = &ring[i - 1];
+		Point3D free_nbrs[dirs_len];
+		bool free_dir[dirs_len];
+		int num_free = 0;
+		for (int j = 0; j < dirs_len; j++)
+		{
+			Point3D to = pt_add(from, &dirs[j]);
+			free_dir[j] = __cell_free(melt, __cell(melt, &to));
+			if (free_dir[j]) free_nbrs[num_free++] = dirs[j];
+		}
+		if (num_free == 0)
+		{
+			grown = false;
+			break;
+		}
+
+		float probs[dirs_len];
+		special_prob_dist(probs, N - i, &node, job->dim, dirs, dirs_len);
+		int j = chain_pick_dir(probs, dirs_len, u_dir);
+		Point3D dir = free_dir[j] ? dirs[j] : free_nbrs[((uint64_t)u_free * (uint64_t)num_free) >> 32];
+		node = pt_add(&node, &dir);
+		ring[i] = pt_add(&node, &start);
+
+		// another ring may have claimed the site since we looked
+		uint64_t site = __cell(melt, &ring[i]);
+		if (!__claim(melt, site, owner))
+		{
+			grown = false;
+			break;
+		}
+		claimed[num_claimed++] = site;
+	}
+	if (grown && is_closed(ring, N)) return true;
+	__release(melt, claimed, num_claimed);
+	return false;
+}
+
+/* Cell of site p, wrapped into the box */
+static uint64_t __cell(const Melt *melt, const Point3D *p)
+{
+	int64_t side = melt->box;
+	int64_t x = (int64_t)lrintf(p->x) % side;
+	int64_t y = (int64_t)lrintf(p->y) % side;
+	int64_t z = (int64_t)lrintf(p->z) % side;
+	if (x < 0) x += side;
+	if (y < 0) y += side;
+	if (z < 0) z += side;
+	return ((uint64_t)z * side + y) * side + x;
+}
+
+static bool __cell_free(const Melt *melt, uint64_t cell)
+{
+	return __atomic_load_n(&melt->cells[cell], __ATOMIC_RELAXED) == 0;
+}
+
+static bool __claim(Melt *melt, uint64_t cell, uint32_t owner)
+{
+	return __sync_bool_compare_and_swap(&melt->cells[cell], 0, owner);
+}
+
+static void __release(Melt *melt, const uint64_t claimed[], int num_claimed)
+{
+	for (int i = 0; i < num_claimed; i++) __atomic_store_n(&melt->cells[claimed[i]], 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,97 @@
+#ifndef MELT_H_
+#define MELT_H_
+
+#include <stdint.h>
+#include "ensemble.h"
+#include "ensemble_file.h"
+#include "linking.h"
+
+#define MELT_TRUE 0
+#define MELT_FALSE -1
+#define MELT_MALLOC_ERROR -2
+#define MELT_INVALID_PARAMS -3
+
+#define MELT_DEFAULT_ATTEMPTS 10000 /* per ring, when params give no limit */
+#define MELT_MAX_FILL 2             /* rings fill at most 1 / MELT_MAX_FILL of the sites */
+
+/*
+ * A melt: closed rings packed at finite density in a periodic box.
+ *
+ * Every ring is grown with the worm's steps (see generate_chain_worm), but
+ * against one excluded-volume grid shared by all rings and wrapped
+ * periodically with side box, where a ring claims the site of every monomer.
+ * Sites are all even or all odd, so two bonds can only meet at a site they
+ * share; no two rings, and no ring and any periodic image, share a site, so
+ * none of them touch and every pair of rings has a linking number.
+ *
+ * Claims are single compare-and-swaps on the cell, so rings grow in parallel
+ * without locks. An attempt that is locked out, does not close, or loses a
+ * claim to another ring releases its cells and starts over from a new site.
+ * Ring k draws from stream k of ensemble_stream: attempt a walks on the
+ * counters sample_closed_chain would give it and picks its starting site on
+ * {0, ENS_AUX_STREAM | a}. With one thread a melt is reproducible from its
+ * seed; with more, which ring wins a contested cell depends on scheduling.
+ *
+ * Rings are stored unwrapped, with monomer 0 inside [0, box)^3.
+ */
+typedef struct
+{
+	int N;             /* monomers per ring */
+	int num_chains;
+	int box;           /* side of the periodic box; even, so the lattice wraps onto itself */
+	int num_threads;   /* <= 0 means one thread */
+	int max_attempts;  /* per ring before giving up on it; <= 0 means MELT_DEFAULT_ATTEMPTS */
+	uint32_t seed;
+} MeltParams, melt_params;
+
+typedef struct
+{
+	int N;
+	int num_chains;
+	int box;
+	Point3D *chains;   /* ring k starts at chains + k * N */
+	int *attempts;     /* attempts ring k took; 0 if it was never placed */
+	uint32_t *cells;   /* box^3 site claims: ring index + 1, or 0 if free */
+} Melt, melt;
+
+/*  Grow params->num_chains rings of params->N monomers into melt
+
+    Returns:
+        MELT_TRUE on success
+        MELT_FALSE if some ring could not be placed within max_attempts; the
+            rest are still grown, and the failed ones have attempts 0
+        MELT_INVALID_PARAMS if N is below 4, box is odd or below 2, or the
+            rings would fill more than 1 / MELT_MAX_FILL of the box's
+            sites, past which the last rings rarely find room
+        MELT_MALLOC_ERROR if the melt or a worker's buffers could not be
+            allocated
+*/
+int melt_generate(Melt *melt, const MeltParams *params,
+	Point3D dirs[], int dirs_len, int dim);
+
+void melt_destroy(Melt *melt);
+
+static inline const Point3D *melt_ring(const Melt *melt, int k)
+{
+	return melt->chains + (size_t)k * melt->N;
+}
+
+/*  Linking number of ring a with the periodic copies of a different ring
+    b: the sum over every image of b, b plus a multiple of the box along
+    each axis, whose bounding box meets a's. A ring may span more than half
+    the box, so a can link several images of b at once; the images left out
+    are split from a by a plane and link it 0 times.
+
+    Returns:
+        as link_crossings
+*/
+int melt_link(const Melt *melt, int a, int b, int *lk);
+
+/*  Write the placed rings to an ensemble file, with header.box set
+
+    Returns:
+        as ens_write_chains
+*/
+int melt_write(const Melt *melt, const char *path, uint32_t seed);
+
+#endif /* MELT_H_ */
@@ -16,12 +16,27 @@ bool flt_near_eq(float a, float b, float eps)
     return fabs(a - b) <= ( (fabs(a) < fabs(b) ? fabs(b) : fabs(a)) * eps);
 }
 
-int rand_int(threefry2x32_ctr_t *ctr, threefry2x32_key_t *key, 
-	int a, int b)
+uint32_t rand_u32(threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
 {
 	ctr->v[0]++;
 	threefry2x32_ctr_t rand = threefry2x32(*ctr, *key);
-	return rand.v[0] % (b - a) + a;
+	return rand.v[0];
+}
+
+int rand_int(threefry2x32_ctr_t *ctr, threefry2x32_key_t *key, 
+	int a, int b)
+{
+	// Lemire's multiply-and-reject: unlike rand % n, every value of [a, b)
+	// is exactly equally likely, and there is no division unless the low
+	// word lands in the short part of a bucket
+	uint32_t n = (uint32_t)b - (uint32_t)a;
+	uint64_t m = (uint64_t)rand_u32(ctr, key) * n;
+	if ((uint32_t)m < n)
+	{
+		uint32_t threshold = -n % n;
+		while ((uint32_t)m < threshold) m = (uint64_t)rand_u32(ctr, key) * n;
+	}
+	return a + (int)(m >> 32);
 }
 
 float rand_flt(threefry2x32_ctr_t *ctr, threefry2x32_key_t *key,
@@ -3,6 +3,7 @@
 
 #include <string.h> /* memcpy */
 #include <stdbool.h>
+#include <stdint.h> /* uint32_t */
 #include <math.h> /* fabs */
 #include <Random123/threefry.h>
 #include <Random123/u01fixedpt.h>
@@ -11,6 +12,9 @@ void flt_to_bytes(unsigned char byte_buff[4], float val);
 
 bool flt_near_eq(float a, float b, float eps);
 
+uint32_t rand_u32(threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+/* Uniform in [a, b), a < b, without modulo bias */
 int rand_int(threefry2x32_ctr_t *ctr, threefry2x32_key_t *key, 
 	int a, int b);
 
@@ -0,0 +1,131 @@
+#define _POSIX_C_SOURCE 200809L /* posix_memalign */
+#include <stdlib.h>
+#include <string.h>
+#include "occ_bitmap.h"
+
+#define MIN_BLOCKS 16
+
+/* PRIVATE FUNCTIONS */
+static Point3D __block_pt(const LatticePoint *block);
+static uint32_t __enter_block(OccBitmap *bm, const LatticePoint *block);
+static OccBlock *__alloc_blocks(uint64_t capacity);
+static void __forget_cache(OccBitmap *bm);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int occ_bitmap_init(OccBitmap *bm, uint64_t num_sites)
+{
+	// a walk enters a new block every few steps at most; start at one per 8
+	uint64_t capacity = num_sites / OCC_BLOCK_SIDE > MIN_BLOCKS ? num_sites / OCC_BLOCK_SIDE : MIN_BLOCKS;
+	if (occ_init(&bm->directory, capacity) != OCC_TRUE) return OCC_MALLOC_ERROR;
+	bm->blocks = __alloc_blocks(capacity);
+	if (bm->blocks == NULL)
+	{
+		occ_destroy(&bm->directory);
+		return OCC_MALLOC_ERROR;
+	}
+	bm->capacity = capacity;
+	bm->number_blocks = 0;
+	bm->used_sites = 0;
+	__forget_cache(bm);
+	return OCC_TRUE;
+}
+
+int occ_bitmap_destroy(OccBitmap *bm)
+{
+	occ_destroy(&bm->directory);
+	free(bm->blocks);
+	bm->blocks = NULL;
+	bm->capacity = 0;
+	bm->number_blocks = 0;
+	bm->used_sites = 0;
+	return OCC_TRUE;
+}
+
+void occ_bitmap_reset(OccBitmap *bm)
+{
+	// blocks are cleared as they are handed out again
+	occ_reset(&bm->directory);
+	bm->number_blocks = 0;
+	bm->used_sites = 0;
+	__forget_cache(bm);
+}
+
+int occ_bitmap_insert(OccBitmap *bm, const Point3D *pt)
+{
+	LatticePoint p = lat_from_pt(pt);
+	LatticePoint block = occ_bitmap_block_of(&p);
+	OccBlockRef *ref = occ_bitmap_ref(bm, &block);
+	if (ref->index == OCC_NO_BLOCK)
+	{
+		ref->index = __enter_block(bm, &block);
+		if (ref->index == OCC_NO_BLOCK) return OCC_MALLOC_ERROR;
+	}
+	uint32_t index = ref->index;
+	unsigned bit = occ_bitmap_bit(&p);
+	uint64_t *word = &bm->blocks[index].words[bit >> 6];
+	uint64_t mask = UINT64_C(1) << (bit & 63);
+	if (*word & mask) return OCC_ALREADY_PRESENT;
+	*word |= mask;
+	bm->used_sites++;
+	return OCC_TRUE;
+}
+
+uint32_t occ_bitmap_find_block(const OccBitmap *bm, const LatticePoint *block)
+{
+	Point3D key = __block_pt(block);
+	int index;
+	if (occ_lookup(&bm->directory, &key, &index) != OCC_TRUE) return OCC_NO_BLOCK;
+	return (uint32_t)index;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+/* The directory is keyed on sites; a block's key is its coordinates as one */
+static Point3D __block_pt(const LatticePoint *block)
+{
+	return lat_to_pt(block);
+}
+
+/* Hand out a cleared block for block, growing the pool if needed */
+static uint32_t __enter_block(OccBitmap *bm, const LatticePoint *block)
+{
+	if (bm->number_blocks == bm->capacity)
+	{
+		uint64_t capacity = bm->capacity * 2;
+		OccBlock *blocks = __alloc_blocks(capacity);
+		if (blocks == NULL) return OCC_NO_BLOCK;
+		memcpy(blocks, bm->blocks, bm->number_blocks * sizeof(OccBlock));
+		free(bm->blocks);
+		bm->blocks = blocks;
+		bm->capacity = capacity;
+	}
+	uint32_t index = (uint32_t)bm->number_blocks;
+	Point3D key = __block_pt(block);
+	if (occ_insert(&bm->directory, &key, (int)index) != OCC_TRUE) return OCC_NO_BLOCK;
+	memset(&bm->blocks[index], 0, sizeof(OccBlock));
+	bm->number_blocks++;
+	return index;
+}
+
+/* Blocks start on cache lines, so each neighbour test touches one line */
+static OccBlock *__alloc_blocks(uint64_t capacity)
+{
+	void *blocks;
+	if (posix_memalign(&blocks, sizeof(OccBlock), capacity * sizeof(OccBlock)) != 0) return NULL;
+	return (OccBlock *)blocks;
+}
+
+/* Forget every cached block; no block has coordinates INT32_MIN */
+static void __forget_cache(OccBitmap *bm)
+{
+	for (int i = 0; i < OCC_CACHE_SIZE; i++)
+	{
+		bm->cache[i].block.x = INT32_MIN;
+		bm->cache[i].index = OCC_NO_BLOCK;
+	}
+}
@@ -0,0 +1,128 @@
+#ifndef OCC_BITMAP_H_
+#define OCC_BITMAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "occupancy.h"
+
+#define OCC_BLOCK_BITS 3                      /* blocks are 8 sites along each axis */
+#define OCC_BLOCK_SIDE (1 << OCC_BLOCK_BITS)
+#define OCC_BLOCK_WORDS 8                     /* 512 bits: one cache line */
+#define OCC_NO_BLOCK UINT32_MAX
+#define OCC_CACHE_BITS 2                      /* the cache covers 4 x 4 x 4 blocks */
+#define OCC_CACHE_SIZE (1 << (3 * OCC_CACHE_BITS))
+
+/*
+ * Bit-per-site occupancy for chain generation.
+ *
+ * A closed chain of N steps never leaves the box of half-width N / 2 around
+ * its first monomer, but a walk fills only a thin tube of that box, so the
+ * box is cut into 8 x 8 x 8 blocks of one bit per site and only the blocks a
+ * walk enters are kept. Sites within a block are in Morton order, so the 8
+ * neighbours of a site share the block's cache line or sit in an adjacent
+ * block. An Occupancy maps block coordinates to blocks, and a small
+ * direct-mapped cache in front of it remembers the blocks (or their absence)
+ * around the walk, where nearly every test lands.
+ *
+ * Memory is one 64-byte block per block entered, so at most 64 N bytes plus
+ * the directory for a walk of N sites, whatever its shape. occ_bitmap_reset
+ * is O(1), like occ_reset. Unlike an Occupancy, sites carry no payload.
+ */
+typedef struct
+{
+	uint64_t words[OCC_BLOCK_WORDS];
+} OccBlock, occ_block;
+
+typedef struct
+{
+	LatticePoint block;
+	uint32_t index;         /* OCC_NO_BLOCK if the block was not entered */
+} OccBlockRef, occ_block_ref;
+
+typedef struct
+{
+	Occupancy directory;    /* block coordinates -> index into blocks */
+	OccBlock *blocks;       /* the first number_blocks are in use */
+	uint64_t number_blocks;
+	uint64_t capacity;
+	uint64_t used_sites;
+	OccBlockRef cache[OCC_CACHE_SIZE]; /* slot from the low bits of the block coordinates */
+} OccBitmap, occ_bitmap;
+
+/*  Initialize the bitmap with room for walks of num_sites sites before it
+    has to grow
+
+    Returns:
+        OCC_MALLOC_ERROR: If an error occured setting up the memory
+        OCC_TRUE: On success
+*/
+int occ_bitmap_init(OccBitmap *bm, uint64_t num_sites);
+
+/* Free all memory that is part of the bitmap */
+int occ_bitmap_destroy(OccBitmap *bm);
+
+/* Forget every site in O(1); capacity is kept for the next attempt */
+void occ_bitmap_reset(OccBitmap *bm);
+
+/*  Mark the site at pt as occupied
+
+    Returns:
+        OCC_TRUE if inserted
+        OCC_ALREADY_PRESENT if the site was already occupied
+        OCC_MALLOC_ERROR if unable to grow the bitmap
+*/
+int occ_bitmap_insert(OccBitmap *bm, const Point3D *pt);
+
+/* Index of the block at block coordinates block, or OCC_NO_BLOCK if none was entered */
+uint32_t occ_bitmap_find_block(const OccBitmap *bm, const LatticePoint *block);
+
+/* Block coordinates of site p: p / 8, rounded down */
+static inline LatticePoint occ_bitmap_block_of(const LatticePoint *p)
+{
+	LatticePoint block = {p->x >> OCC_BLOCK_BITS, p->y >> OCC_BLOCK_BITS, p->z >> OCC_BLOCK_BITS};
+	return block;
+}
+
+/* Morton index of site p within its block, in [0, 512) */
+static inline unsigned occ_bitmap_bit(const LatticePoint *p)
+{
+	// bits i of x, y, z go to bits 3i, 3i + 1, 3i + 2
+	static const unsigned spread[OCC_BLOCK_SIDE] = {0, 1, 8, 9, 64, 65, 72, 73};
+	unsigned mask = OCC_BLOCK_SIDE - 1;
+	return spread[p->x & mask] | spread[p->y & mask] << 1 | spread[p->z & mask] << 2;
+}
+
+/* The cache entry for block, looked up in the directory if it holds another */
+static inline OccBlockRef *occ_bitmap_ref(OccBitmap *bm, const LatticePoint *block)
+{
+	unsigned mask = (1 << OCC_CACHE_BITS) - 1;
+	unsigned slot = (block->x & mask)
+		| (block->y & mask) << OCC_CACHE_BITS
+		| (block->z & mask) << (2 * OCC_CACHE_BITS);
+	OccBlockRef *ref = &bm->cache[slot];
+	if (!lat_equal(&ref->block, block))
+	{
+		ref->block = *block;
+		ref->index = occ_bitmap_find_block(bm, block);
+	}
+	return ref;
+}
+
+/* Whether the site at pt is occupied; takes bm non-const for the cache */
+static inline bool occ_bitmap_contains(OccBitmap *bm, const Point3D *pt)
+{
+	LatticePoint p = lat_from_pt(pt);
+	LatticePoint block = occ_bitmap_block_of(&p);
+	uint32_t index = occ_bitmap_ref(bm, &block)->index;
+	if (index == OCC_NO_BLOCK) return false;
+	unsigned bit = occ_bitmap_bit(&p);
+	return (bm->blocks[index].words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+/* Return the number of occupied sites */
+static inline uint64_t occ_bitmap_length(const OccBitmap *bm)
+{
+	return bm->used_sites;
+}
+
+#endif /* OCC_BITMAP_H_ */
@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <string.h>
+#include "occupancy.h"
+
+#define MAX_LOAD_FACTOR 0.5 /* linear probing degrades quickly past this */
+#define MIN_SLOTS 16
+
+/* PRIVATE FUNCTIONS */
+static bool __slot_live(const Occupancy *occ, uint64_t index);
+static bool __find(const Occupancy *occ, LatticeKey key, uint64_t *index);
+static int __grow(Occupancy *occ);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int occ_init(Occupancy *occ, uint64_t num_sites)
+{
+	uint64_t num_slots = MIN_SLOTS;
+	while (num_slots * MAX_LOAD_FACTOR < num_sites) num_slots <<= 1;
+	occ->slots = (occupancy_slot *)calloc(num_slots, sizeof(occupancy_slot));
+	if (occ->slots == NULL) return OCC_MALLOC_ERROR;
+	occ->number_slots = num_slots;
+	occ->used_slots = 0;
+	occ->epoch = 1; /* epoch 0 is never live, so calloc'd slots start empty */
+	return OCC_TRUE;
+}
+
+int occ_destroy(Occupancy *occ)
+{
+	free(occ->slots);
+	occ->slots = NULL;
+	occ->number_slots = 0;
+	occ->used_slots = 0;
+	occ->epoch = 0;
+	return OCC_TRUE;
+}
+
+int occ_copy(Occupancy *dst, const Occupancy *src)
+{
+	if (dst->number_slots != src->number_slots)
+	{
+		occupancy_slot *slots = (occupancy_slot *)realloc(dst->slots,
+			src->number_slots * sizeof(occupancy_slot));
+		if (slots == NULL) return OCC_MALLOC_ERROR;
+		dst->slots = slots;
+		dst->number_slots = src->number_slots;
+	}
+	memcpy(dst->slots, src->slots, src->number_slots * sizeof(occupancy_slot));
+	dst->used_slots = src->used_slots;
+	dst->epoch = src->epoch;
+	return OCC_TRUE;
+}
+
+void occ_reset(Occupancy *occ)
+{
+	occ->used_slots = 0;
+	occ->epoch++;
+	// on wrap-around, stale slots could alias the new epoch: wipe them once
+	if (occ->epoch == 0)
+	{
+		memset(occ->slots, 0, occ->number_slots * sizeof(occupancy_slot));
+		occ->epoch = 1;
+	}
+}
+
+int occ_insert(Occupancy *occ, const Point3D *pt, int value)
+{
+	LatticeKey key = lat_key_from_pt(pt);
+	uint64_t index;
+	if (__find(occ, key, &index)) return OCC_ALREADY_PRESENT;
+
+	if ((double)(occ->used_slots + 1) > occ->number_slots * MAX_LOAD_FACTOR)
+	{
+		if (__grow(occ) != OCC_TRUE) return OCC_MALLOC_ERROR;
+		__find(occ, key, &index);
+	}
+	occupancy_slot *slot = &occ->slots[index];
+	slot->key = key;
+	slot->value = value;
+	slot->epoch = occ->epoch;
+	occ->used_slots++;
+	return OCC_TRUE;
+}
+
+int occ_lookup(const Occupancy *occ, const Point3D *pt, int *value)
+{
+	uint64_t index;
+	if (!__find(occ, lat_key_from_pt(pt), &index)) return OCC_FALSE;
+	if (value) *value = occ->slots[index].value;
+	return OCC_TRUE;
+}
+
+/*
+ * Backward-shift deletion: rather than leave a tombstone, pull later members
+ * of the probe run into the hole so lookups never have to skip dead slots.
+ */
+int occ_remove(Occupancy *occ, const Point3D *pt)
+{
+	uint64_t hole;
+	if (!__find(occ, lat_key_from_pt(pt), &hole)) return OCC_FALSE;
+
+	uint64_t mask = occ->number_slots - 1;
+	uint64_t i = hole;
+	while (true)
+	{
+		i = (i + 1) & mask;
+		if (!__slot_live(occ, i)) break;
+		occupancy_slot *slot = &occ->slots[i];
+		uint64_t home = lat_key_hash(slot->key) & mask;
+		// only move the slot if the hole lies on its probe path
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			occ->slots[hole] = *slot;
+			hole = i;
+		}
+	}
+	occ->slots[hole].epoch = 0;
+	occ->used_slots--;
+	return OCC_TRUE;
+}
+
+uint64_t occ_length(const Occupancy *occ)
+{
+	return occ->used_slots;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static bool __slot_live(const Occupancy *occ, uint64_t index)
+{
+	return occ->slots[index].epoch == occ->epoch;
+}
+
+/*
+ * Returns true and the slot index if the site is present, otherwise false and
+ * the index of the first free slot on its probe path.
+ */
+static bool __find(const Occupancy *occ, LatticeKey key, uint64_t *index)
+{
+	uint64_t mask = occ->number_slots - 1;
+	uint64_t i = lat_key_hash(key) & mask;
+	while (__slot_live(occ, i))
+	{
+		if (occ->slots[i].key == key)
+		{
+			*index = i;
+			return true;
+		}
+		i = (i + 1) & mask;
+	}
+	*index = i;
+	return false;
+}
+
+static int __grow(Occupancy *occ)
+{
+	uint64_t num_slots = occ->number_slots << 1;
+	occupancy_slot *slots = (occupancy_slot *)calloc(num_slots, sizeof(occupancy_slot));
+	if (slots == NULL) return OCC_MALLOC_ERROR;
+
+	uint64_t mask = num_slots - 1;
+	for (uint64_t i = 0; i < occ->number_slots; i++)
+	{
+		if (!__slot_live(occ, i)) continue;
+		occupancy_slot slot = occ->slots[i];
+		uint64_t j = lat_key_hash(slot.key) & mask;
+		while (slots[j].epoch != 0) j = (j + 1) & mask;
+		slot.epoch = 1;
+		slots[j] = slot;
+	}
+	free(occ->slots);
+	occ->slots = slots;
+	occ->number_slots = num_slots;
+	occ->epoch = 1;
+	return OCC_TRUE;
+}
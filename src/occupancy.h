@@ -0,0 +1,99 @@
+#ifndef OCCUPANCY_H_
+#define OCCUPANCY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "point3d.h"
+#include "lattice.h"
+
+#define OCC_TRUE 0
+#define OCC_FALSE -1
+#define OCC_MALLOC_ERROR -2
+#define OCC_ALREADY_PRESENT 1
+
+/*
+ * Occupancy index for lattice sites visited during chain generation.
+ *
+ * Unlike PointSet, which is built once from a finished chain, an Occupancy
+ * is meant to live for a whole generation attempt (or a whole run) and be
+ * updated one site at a time. Every live slot carries the epoch it was
+ * written in, so occ_reset only bumps the epoch: clearing the index between
+ * attempts costs O(1) no matter how many sites were visited.
+ *
+ * Each site stores an int payload (the monomer index, for chains) so that
+ * callers can tell *which* monomer occupies a site, not just that one does.
+ */
+
+typedef struct
+{
+	LatticeKey key;
+	int32_t value;
+	uint32_t epoch; /* slot is live iff epoch == owning index's epoch */
+} OccupancySlot, occupancy_slot;
+
+typedef struct
+{
+	occupancy_slot *slots;
+	uint64_t number_slots; /* always a power of two */
+	uint64_t used_slots;
+	uint32_t epoch;
+} Occupancy, occupancy;
+
+/*  Initialize the index with room for at least num_sites sites before the
+    first rehash
+
+    Returns:
+        OCC_MALLOC_ERROR: If an error occured setting up the memory
+        OCC_TRUE: On success
+*/
+int occ_init(Occupancy *occ, uint64_t num_sites);
+
+/* Free all memory that is part of the index */
+int occ_destroy(Occupancy *occ);
+
+/*  Make dst an exact copy of src, (re)allocating dst's slots if the two
+    capacities differ; dst must have been initialized
+
+    Returns:
+        OCC_MALLOC_ERROR: If an error occured setting up the memory
+        OCC_TRUE: On success
+*/
+int occ_copy(Occupancy *dst, const Occupancy *src);
+
+/* Forget every site in O(1); capacity is kept for the next attempt */
+void occ_reset(Occupancy *occ);
+
+/*  Mark the site at pt as occupied by value
+
+    Returns:
+        OCC_TRUE if inserted
+        OCC_ALREADY_PRESENT if the site was already occupied (value unchanged)
+        OCC_MALLOC_ERROR if unable to grow the index
+*/
+int occ_insert(Occupancy *occ, const Point3D *pt, int value);
+
+/*  Look up the site at pt, writing its payload to value if non-NULL
+
+    Returns:
+        OCC_TRUE if occupied
+        OCC_FALSE if free
+*/
+int occ_lookup(const Occupancy *occ, const Point3D *pt, int *value);
+
+static inline bool occ_contains(const Occupancy *occ, const Point3D *pt)
+{
+	return occ_lookup(occ, pt, NULL) == OCC_TRUE;
+}
+
+/*  Free the site at pt
+
+    Returns:
+        OCC_TRUE if removed
+        OCC_FALSE if the site was not occupied
+*/
+int occ_remove(Occupancy *occ, const Point3D *pt);
+
+/* Return the number of occupied sites */
+uint64_t occ_length(const Occupancy *occ);
+
+#endif /* OCCUPANCY_H_ */
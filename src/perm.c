@@ -0,0 +1,227 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <math.h>
+#include "perm.h"
+
+/* one partial walk of the population */
+typedef struct
+{
+	Point3D *chain;
+	Occupancy occ;
+	double weight;
+} perm_walk;
+
+/* PRIVATE FUNCTIONS */
+static void __grow_walk(perm_walk *walk, int i, int N, Point3D dirs[],
+	int dirs_len, int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+static int __collect(PermResult *res, perm_walk **live, int num_live, int N);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int perm_generate(PermResult *res, const PermParams *params,
+	Point3D dirs[], int dirs_len, int dim,
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	assert(params->N > 1);
+	assert(params->population > 0);
+	int N = params->N;
+	int capacity = 2 * params->population;
+	res->chains = NULL;
+	res->weights = NULL;
+	res->num_closed = 0;
+	res->log_norm = 0.0;
+
+	// every walk is allocated up front; pruned walks go back on the free list
+	perm_walk *pool = (perm_walk *)calloc(capacity, sizeof(perm_walk));
+	perm_walk **live = (perm_walk **)malloc(capacity * sizeof(perm_walk *));
+	perm_walk **next = (perm_walk **)malloc(capacity * sizeof(perm_walk *));
+	perm_walk **spare = (perm_walk **)malloc(capacity * sizeof(perm_walk *));
+	int status = (pool && live && next && spare) ? PERM_TRUE : PERM_MALLOC_ERROR;
+	int num_allocated = 0;
+	for (; status == PERM_TRUE && num_allocated < capacity; num_allocated++)
+	{
+		perm_walk *walk = &pool[num_allocated];
+		walk->chain = (Point3D *)malloc(N * sizeof(Point3D));
+		if (walk->chain == NULL || occ_init(&walk->occ, N) != OCC_TRUE)
+		{
+			free(walk->chain);
+			status = PERM_MALLOC_ERROR;
+			break;
+		}
+	}
+
+	int num_live = 0, num_spare = 0;
+	if (status == PERM_TRUE)
+	{
+		for (int w = 0; w < capacity; w++)
+		{
+			perm_walk *walk = &pool[w];
+			if (w < params->population)
+			{
+				pt_init(&walk->chain[0]);
+				occ_insert(&walk->occ, &walk->chain[0], 0);
+				walk->weight = 1.0;
+				live[num_live++] = walk;
+			}
+			else spare[num_spare++] = walk;
+		}
+	}
+
+	for (int i = 1; status == PERM_TRUE && i < N && num_live > 0; i++)
+	{
+		double total = 0.0;
+		for (int w = 0; w < num_live; w++)
+		{
+			__grow_walk(live[w], i, N, dirs, dirs_len, dim, ctr, key);
+			total += live[w]->weight;
+		}
+		if (total == 0.0)
+		{
+			num_live = 0;
+			break;
+		}
+		// keep weights O(1): the running normalization goes to log_norm
+		double mean = total / num_live;
+		res->log_norm += log(mean);
+
+		int num_next = 0;
+		for (int w = 0; w < num_live; w++)
+		{
+			perm_walk *walk = live[w];
+			walk->weight /= mean;
+			if (walk->weight == 0.0)
+			{
+				spare[num_spare++] = walk;
+				continue;
+			}
+			if (walk->weight < params->prune_ratio)
+			{
+				if (rand_flt(ctr, key, 0.0, 1.0) < 0.5)
+				{
+					spare[num_spare++] = walk;
+					continue;
+				}
+				walk->weight *= 2.0;
+			}
+			// enrich, but never on the final step where clones would be identical
+			int copies = 1;
+			if (walk->weight > params->enrich_ratio && i < N - 1)
+			{
+				copies = (int)ceil(walk->weight / params->enrich_ratio);
+				if (copies > params->max_clones) copies = params->max_clones;
+				if (copies - 1 > num_spare) copies = num_spare + 1;
+			}
+			walk->weight /= copies;
+			next[num_next++] = walk;
+			for (int c = 1; c < copies; c++)
+			{
+				perm_walk *clone = spare[--num_spare];
+				for (int k = 0; k <= i; k++) pt_copy(&walk->chain[k], &clone->chain[k]);
+				if (occ_copy(&clone->occ, &walk->occ) != OCC_TRUE)
+				{
+					spare[num_spare++] = clone;
+					status = PERM_MALLOC_ERROR;
+					break;
+				}
+				clone->weight = walk->weight;
+				next[num_next++] = clone;
+			}
+		}
+		perm_walk **tmp = live;
+		live = next;
+		next = tmp;
+		num_live = num_next;
+	}
+
+	if (status == PERM_TRUE) status = __collect(res, live, num_live, N);
+
+	for (int w = 0; w < num_allocated; w++)
+	{
+		free(pool[w].chain);
+		occ_destroy(&pool[w].occ);
+	}
+	free(pool);
+	free(live);
+	free(next);
+	free(spare);
+	return status;
+}
+
+void perm_result_destroy(PermResult *res)
+{
+	free(res->chains);
+	free(res->weights);
+	res->chains = NULL;
+	res->weights = NULL;
+	res->num_closed = 0;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+/*
+ * Place monomer i of walk, drawing among the free neighbors with probability
+ * proportional to special_prob_dist. The weight picks up the inverse of the
+ * proposal probability (free_mass / probs[choice]), or drops to zero if the
+ * walk is locked out or, on the last step, fails to close.
+ */
+static void __grow_walk(perm_walk *walk, int i, int N, Point3D dirs[],
+	int dirs_len, int dim, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	if (walk->weight == 0.0) return;
+	Point3D *node = &walk->chain[i - 1];
+	float probs[dirs_len];
+	special_prob_dist(probs, N - i, node, dim, dirs, dirs_len);
+
+	float free_mass = 0.0;
+	for (int j = 0; j < dirs_len; j++)
+	{
+		Point3D nbr = pt_add(node, &dirs[j]);
+		if (occ_contains(&walk->occ, &nbr)) probs[j] = 0.0;
+		free_mass += probs[j];
+	}
+	if (free_mass <= 0.0)
+	{
+		walk->weight = 0.0;
+		return;
+	}
+	// same alias draw as chain_rand_choice, but we need the index for the weight
+	float prob[dirs_len];
+	int alias[dirs_len], work[dirs_len];
+	AliasTable table;
+	alias_bind(&table, dirs_len, prob, alias, work);
+	alias_build(&table, probs, dirs_len);
+	int choice = alias_draw(&table, ctr, key);
+	Point3D dir = dirs[choice];
+	walk->chain[i] = pt_add(node, &dir);
+	occ_insert(&walk->occ, &walk->chain[i], i);
+	walk->weight *= free_mass / probs[choice];
+	if (i == N - 1 && !is_closed(walk->chain, N)) walk->weight = 0.0;
+}
+
+static int __collect(PermResult *res, perm_walk **live, int num_live, int N)
+{
+	int num_closed = 0;
+	for (int w = 0; w < num_live; w++)
+	{
+		if (live[w]->weight > 0.0) num_closed++;
+	}
+	if (num_closed == 0) return PERM_TRUE;
+	res->chains = (Point3D *)malloc((size_t)num_closed * N * sizeof(Point3D));
+	res->weights = (double *)malloc(num_closed * sizeof(double));
+	if (res->chains == NULL || res->weights == NULL)
+	{
+		perm_result_destroy(res);
+		return PERM_MALLOC_ERROR;
+	}
+	for (int w = 0; w < num_live; w++)
+	{
+		if (live[w]->weight == 0.0) continue;
+		chain_copy(live[w]->chain, N, res->chains + (size_t)res->num_closed * N);
+		res->weights[res->num_closed++] = live[w]->weight;
+	}
+	return PERM_TRUE;
+}
@@ -0,0 +1,57 @@
+#ifndef PERM_H_
+#define PERM_H_
+
+#include "chain.h"
+
+#define PERM_TRUE 0
+#define PERM_MALLOC_ERROR -2
+
+/*
+ * Pruned-enriched Rosenbluth (PERM) growth of closed chains.
+ *
+ * A population of partial walks is grown one monomer at a time, breadth
+ * first. Each walk steps to a free neighbor drawn from special_prob_dist
+ * restricted to the free sites, and its weight is multiplied by the inverse
+ * of that proposal probability. After every step the weights are divided by
+ * their mean; walks lighter than prune_ratio are killed with probability 1/2
+ * (and doubled otherwise), walks heavier than enrich_ratio are split into up
+ * to max_clones copies sharing the weight. Walks that get locked out simply
+ * drop out instead of throwing the whole attempt away, as generate_chain_worm
+ * must.
+ */
+typedef struct
+{
+	int N;              /* monomers per chain */
+	int population;     /* walks started; the pool holds twice as many */
+	double prune_ratio; /* e.g. 0.2 */
+	double enrich_ratio;/* e.g. 2.0 */
+	int max_clones;     /* e.g. 4 */
+} PermParams, perm_params;
+
+/*
+ * Closed chains produced by one perm_generate call. The importance weight of
+ * chain c (for uniform sampling of closed self-avoiding rings through the
+ * origin) is weights[c] * exp(log_norm) / population.
+ */
+typedef struct
+{
+	Point3D *chains; /* num_closed * N points */
+	double *weights;
+	int num_closed;
+	double log_norm;
+} PermResult, perm_result;
+
+/*  Grow params->population walks of params->N monomers and collect those
+    that close into res, which perm_result_destroy must later free
+
+    Returns:
+        PERM_TRUE on success (res->num_closed may still be 0)
+        PERM_MALLOC_ERROR if the population could not be allocated
+*/
+int perm_generate(PermResult *res, const PermParams *params,
+	Point3D dirs[], int dirs_len, int dim,
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+void perm_result_destroy(PermResult *res);
+
+#endif /* PERM_H_ */
@@ -0,0 +1,139 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "pivot.h"
+
+/* PRIVATE FUNCTIONS */
+static bool __in_arc(int v, int i, int m, int N);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int pivot_init(PivotChain *pc, Point3D chain[], int N)
+{
+	if (N < 4 || !is_closed(chain, N)) return PIVOT_INVALID_CHAIN;
+	pc->chain = chain;
+	pc->N = N;
+	pc->proposed = 0;
+	pc->accepted = 0;
+	pc->scratch = (Point3D *)malloc(N * sizeof(Point3D));
+	if (pc->scratch == NULL) return PIVOT_MALLOC_ERROR;
+	if (occ_init(&pc->occ, N) != OCC_TRUE)
+	{
+		free(pc->scratch);
+		return PIVOT_MALLOC_ERROR;
+	}
+	for (int i = 0; i < N; i++)
+	{
+		if (occ_insert(&pc->occ, &chain[i], i) != OCC_TRUE)
+		{
+			pivot_destroy(pc);
+			return PIVOT_INVALID_CHAIN;
+		}
+	}
+	return PIVOT_TRUE;
+}
+
+void pivot_destroy(PivotChain *pc)
+{
+	occ_destroy(&pc->occ);
+	free(pc->scratch);
+	pc->scratch = NULL;
+	pc->chain = NULL;
+	pc->N = 0;
+}
+
+bool pivot_step(PivotChain *pc, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	int N = pc->N;
+	Point3D *chain = pc->chain;
+	pc->proposed++;
+
+	// pivots x_i and x_j = x_{i+m}; the arc between them has m - 1 vertices
+	int i = rand_int(ctr, key, 0, N);
+	int m = rand_int(ctr, key, 2, N - 1);
+	int g = rand_int(ctr, key, 0, LAT_NUM_SYMMETRIES);
+	bool reverse = rand_int(ctr, key, 0, 2) == 1;
+	if (g == 0 && !reverse) return false; /* identity */
+
+	// move whichever arc is shorter: the pivots just swap roles
+	if (2 * m > N)
+	{
+		i = (i + m) % N;
+		m = N - m;
+	}
+	int j = (i + m) % N;
+	Point3D S = pt_subtr(&chain[j], &chain[i]);
+	Point3D gS = lat_apply_symmetry(g, &S);
+	if (lat_key_from_pt(&gS) != lat_key_from_pt(&S)) return false;
+
+	// build the proposed arc, rejecting on the first collision with a vertex
+	// that is not itself about to move
+	for (int k = 1; k < m; k++)
+	{
+		Point3D rel = reverse
+			? pt_subtr(&chain[j], &chain[(i + m - k) % N])
+			: pt_subtr(&chain[(i + k) % N], &chain[i]);
+		Point3D image = lat_apply_symmetry(g, &rel);
+		pc->scratch[k] = pt_add(&chain[i], &image);
+		int occupant;
+		if (occ_lookup(&pc->occ, &pc->scratch[k], &occupant) == OCC_TRUE
+			&& !__in_arc(occupant, i, m, N)) return false;
+	}
+
+	// accepted: vacate the old arc before claiming the new sites, since the
+	// two may overlap
+	for (int k = 1; k < m; k++) occ_remove(&pc->occ, &chain[(i + k) % N]);
+	for (int k = 1; k < m; k++)
+	{
+		int idx = (i + k) % N;
+		pt_copy(&pc->scratch[k], &chain[idx]);
+		occ_insert(&pc->occ, &chain[idx], idx);
+	}
+	pc->accepted++;
+	return true;
+}
+
+long pivot_run(PivotChain *pc, long num_steps,
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	long accepted = 0;
+	for (long s = 0; s < num_steps; s++)
+	{
+		if (pivot_step(pc, ctr, key)) accepted++;
+	}
+	return accepted;
+}
+
+void pivot_seed_ring(Point3D chain[], int N)
+{
+	assert(N >= 4 && N % 2 == 0);
+	// walk the four sides of a rectangle in the xy plane (rotated 45 degrees)
+	// while z zig-zags between 0 and 1 so every step is a lattice step
+	int a = N / 4;
+	int b = N / 2 - a;
+	const int side_len[4] = {a, b, a, b};
+	const int side_dir[4][2] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+	pt_init(&chain[0]);
+	int idx = 0;
+	for (int side = 0; side < 4; side++)
+	{
+		for (int s = 0; s < side_len[side] && idx < N - 1; s++, idx++)
+		{
+			chain[idx + 1].x = chain[idx].x + side_dir[side][0];
+			chain[idx + 1].y = chain[idx].y + side_dir[side][1];
+			chain[idx + 1].z = (idx % 2 == 0) ? 1.0 : 0.0;
+		}
+	}
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+/* is vertex v strictly between pivots i and i + m? */
+static bool __in_arc(int v, int i, int m, int N)
+{
+	int offset = ((v - i) % N + N) % N;
+	return offset > 0 && offset < m;
+}
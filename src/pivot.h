@@ -0,0 +1,67 @@
+#ifndef PIVOT_H_
+#define PIVOT_H_
+
+#include <stdbool.h>
+#include "chain.h"
+#include "occupancy.h"
+
+#define PIVOT_TRUE 0
+#define PIVOT_MALLOC_ERROR -2
+#define PIVOT_INVALID_CHAIN -6
+
+/*
+ * Markov chain sampler for closed self-avoiding chains built from the
+ * gen_all_bin_list3 steps, after Madras, Orlitsky & Shepp's two-point pivot
+ * moves for lattice polygons.
+ *
+ * A move picks two vertices x_i and x_j of the ring and a cubic lattice
+ * symmetry g that fixes S = x_j - x_i, then rewrites the vertices strictly
+ * between them as either
+ *
+ *     x_i + g(x_k - x_i)              (pivot), or
+ *     x_i + g(x_j - x_{i+j-k})        (inversion: the arc is also reversed).
+ *
+ * Both keep every step a lattice step and keep the ring closed. The shorter
+ * of the two arcs between x_i and x_j is always the one moved, and the
+ * occupancy index maps sites to vertex indices, so a proposal costs at most
+ * min(j - i, N - j + i) lookups and is usually rejected within a few.
+ */
+typedef struct
+{
+	Point3D *chain;   /* caller-owned ring of N vertices, updated in place */
+	int N;
+	Occupancy occ;    /* site -> index of the vertex occupying it */
+	Point3D *scratch; /* proposed positions of the moving arc */
+	long proposed;
+	long accepted;
+} PivotChain, pivot_chain;
+
+/*  Start a Markov chain from chain, which must be a closed self-avoiding
+    ring of N >= 4 vertices
+
+    Returns:
+        PIVOT_TRUE on success
+        PIVOT_INVALID_CHAIN if chain is not closed or not self-avoiding
+        PIVOT_MALLOC_ERROR if the working memory could not be allocated
+*/
+int pivot_init(PivotChain *pc, Point3D chain[], int N);
+
+/* Free the working memory; the chain itself is left to the caller */
+void pivot_destroy(PivotChain *pc);
+
+/* Propose one move; returns true if it was accepted */
+bool pivot_step(PivotChain *pc, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+/* Propose num_steps moves; returns how many were accepted */
+long pivot_run(PivotChain *pc, long num_steps,
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+/*
+ * Fill chain with a valid closed ring of N vertices (N even and >= 4, as every
+ * closed walk on this lattice has even length) to start a pivot run from. The
+ * ring is a zig-zagged rectangle, far from equilibrium: run O(N) accepted
+ * moves before sampling from it.
+ */
+void pivot_seed_ring(Point3D chain[], int N);
+
+#endif /* PIVOT_H_ */
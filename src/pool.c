@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include "pool.h"
+#include "ensemble_file.h"
+#include "sampler.h"
+#include "simd.h"
+
+/* PRIVATE FUNCTIONS */
+static void __transform(const void *src_pts, void *dst_pts, int num_floats,
+	const int perm[3], const float sign[3], const float shift[3]);
+static void __reverse(Point3D pts[], int first, int last);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int pool_generate(ChainPool *pool, const EnsembleParams *params,
+	Point3D dirs[], int dirs_len, int dim)
+{
+	pool->N = params->N;
+	pool->num_rings = params->num_chains;
+	pool->rings = NULL;
+	if (params->N < 4 || params->N % 2 != 0 || params->num_chains < 1) return POOL_INVALID_PARAMS;
+	pool->rings = (Point3D *)malloc((size_t)params->num_chains * params->N * sizeof(Point3D));
+	if (pool->rings == NULL) return POOL_MALLOC_ERROR;
+	if (ensemble_generate(pool->rings, NULL, params, dirs, dirs_len, dim) != ENS_TRUE)
+	{
+		pool_destroy(pool);
+		return POOL_MALLOC_ERROR;
+	}
+	return POOL_TRUE;
+}
+
+int pool_load(ChainPool *pool, const char *path)
+{
+	pool->rings = NULL;
+	pool->N = 0;
+	pool->num_rings = 0;
+
+	EnsReader reader;
+	int status = ens_reader_open(&reader, path);
+	if (status == ENS_FILE_IO_ERROR) return POOL_IO_ERROR;
+	if (status != ENS_FILE_TRUE) return POOL_FORMAT_ERROR;
+
+	uint64_t count = ens_reader_count(&reader);
+	int N = (int)reader.header->N;
+	status = N > 0 && count <= INT32_MAX ? POOL_TRUE : POOL_FORMAT_ERROR;
+	if (status == POOL_TRUE)
+	{
+		pool->rings = (Point3D *)malloc(count * N * sizeof(Point3D));
+		if (pool->rings == NULL) status = POOL_MALLOC_ERROR;
+	}
+	for (uint64_t k = 0; k < count && status == POOL_TRUE; k++)
+	{
+		Point3D *ring = pool->rings + k * N;
+		if (ens_reader_chain_len(&reader, k) != (uint32_t)N
+			|| ens_reader_chain(&reader, k, ring) != ENS_FILE_TRUE)
+		{
+			status = POOL_FORMAT_ERROR;
+			break;
+		}
+		// copies are rooted at the origin, so the base rings are too
+		Point3D origin = ring[0];
+		for (int i = 0; i < N; i++)
+		{
+			ring[i].x -= origin.x;
+			ring[i].y -= origin.y;
+			ring[i].z -= origin.z;
+		}
+	}
+	ens_reader_close(&reader);
+	if (status != POOL_TRUE)
+	{
+		pool_destroy(pool);
+		return status;
+	}
+	pool->N = N;
+	pool->num_rings = (int)count;
+	return POOL_TRUE;
+}
+
+void pool_destroy(ChainPool *pool)
+{
+	free(pool->rings);
+	pool->rings = NULL;
+	pool->N = 0;
+	pool->num_rings = 0;
+}
+
+void pool_transform(const ChainPool *pool, const PoolDraw *draw, Point3D out[])
+{
+	int N = pool->N;
+	const Point3D *base = pool_ring(pool, draw->ring);
+	// the symmetry as lat_apply_symmetry applies it, split for __transform
+	const int *perm = lat_symmetry_perm(draw->symmetry);
+	float sign[3], shift[3];
+	const float root[3] = {base[draw->root].x, base[draw->root].y, base[draw->root].z};
+	for (int c = 0; c < 3; c++)
+	{
+		sign[c] = (float)lat_symmetry_sign(draw->symmetry, c);
+		shift[c] = sign[c] * root[perm[c]]; // puts the new monomer 0 at the origin
+	}
+	// monomers root .. N - 1 then 0 .. root - 1 of the base ring, each run
+	// transformed straight into place
+	int r = draw->root;
+	__transform(base + r, out, 3 * (N - r), perm, sign, shift);
+	__transform(base, out + (N - r), 3 * r, perm, sign, shift);
+	if (draw->reversed)
+	{
+		// out[i] = copy[(r - i) mod N]: keep monomer 0, reverse the rest
+		__reverse(out, 1, N - 1);
+	}
+}
+
+PoolDraw pool_draw(const ChainPool *pool, Point3D out[],
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	PoolDraw draw;
+	draw.ring = uniform_index(pool->num_rings, ctr, key);
+	draw.symmetry = uniform_index(POOL_NUM_SYMMETRIES, ctr, key);
+	draw.root = uniform_index(pool->N, ctr, key);
+	draw.reversed = rand_u32(ctr, key) & 1;
+	pool_transform(pool, &draw, out);
+	return draw;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+/*
+ * dst = sign * src[perm] - shift for every point of a run of Point3D, seen
+ * as its packed coordinates src[0 .. num_floats - 1].
+ *
+ * Float j of the output is axis c = j % 3 of its point, read from float
+ * j - c + perm[c] of the input, so it lies within two floats of j either way.
+ * Four output floats therefore come from the eight input floats starting two
+ * before them: two unaligned loads and one two-vector shuffle. The shuffle
+ * pattern only depends on j % 3, so three patterns serve the whole run.
+ */
+static void __transform(const void *src_pts, void *dst_pts, int num_floats,
+	const int perm[3], const float sign[3], const float shift[3])
+{
+	const float *src = src_pts;
+	float *dst = dst_pts;
+	vint4 pattern[3];
+	vfloat4 vsign[3], vshift[3];
+	for (int phase = 0; phase < 3; phase++)
+	{
+		for (int lane = 0; lane < 4; lane++)
+		{
+			int c = (phase + lane) % 3;
+			pattern[phase][lane] = lane - c + 2 + perm[c];
+			vsign[phase][lane] = sign[c];
+			vshift[phase][lane] = shift[c];
+		}
+	}
+
+	// the vector loop needs floats j - 2 .. j + 5; the ends are done singly
+	int j = 0;
+	for (; j < 4 && j < num_floats; j++)
+	{
+		int c = j % 3;
+		dst[j] = sign[c] * src[j - c + perm[c]] - shift[c];
+	}
+	for (int phase = 1; j + 6 <= num_floats; j += 4, phase = phase == 2 ? 0 : phase + 1)
+	{
+		vfloat4 lo = vf4_load(src + j - 2);
+		vfloat4 hi = vf4_load(src + j + 2);
+		vfloat4 v = __builtin_shuffle(lo, hi, pattern[phase]);
+		vf4_store(dst + j, vsign[phase] * v - vshift[phase]);
+	}
+	for (; j < num_floats; j++)
+	{
+		int c = j % 3;
+		dst[j] = sign[c] * src[j - c + perm[c]] - shift[c];
+	}
+}
+
+/* Reverse pts[first .. last] */
+static void __reverse(Point3D pts[], int first, int last)
+{
+	while (first < last)
+	{
+		Point3D tmp = pts[first];
+		pts[first++] = pts[last];
+		pts[last--] = tmp;
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdbool.h>
+#include "ensemble.h"
+
+#define POOL_TRUE 0
+#define POOL_MALLOC_ERROR -2
+#define POOL_INVALID_PARAMS -3
+#define POOL_IO_ERROR -7
+#define POOL_FORMAT_ERROR -8
+
+#define POOL_NUM_SYMMETRIES LAT_NUM_SYMMETRIES /* signed permutations of the axes */
+
+/*
+ * A pool of closed rings served as randomly transformed copies.
+ *
+ * The steps of gen_all_bin_list3 are closed under the 48 symmetries of the
+ * cube (the signed permutations of x, y, z), and a ring is still a valid ring
+ * of the same ensemble when re-rooted at any monomer or run backwards. So a
+ * base set of M rings of N monomers stands in for up to 96 N M distinct rings
+ * with the same statistics, and drawing one costs a pass over N points
+ * instead of a generation.
+ *
+ * Base rings are stored back to back with monomer 0 at the origin, and so
+ * are the copies.
+ */
+typedef struct
+{
+	Point3D *rings;
+	int N;
+	int num_rings;
+} ChainPool, chain_pool;
+
+/* One transformed copy: base ring, symmetry, new monomer 0 and direction */
+typedef struct
+{
+	int ring;
+	int symmetry;  /* in [0, POOL_NUM_SYMMETRIES), as for lat_apply_symmetry */
+	int root;
+	bool reversed;
+} PoolDraw, pool_draw_t;
+
+/*  Fill the pool with params->num_chains rings from ensemble_generate
+
+    Returns:
+        POOL_TRUE on success
+        POOL_INVALID_PARAMS if N is odd or below 4, or there are no rings
+        POOL_MALLOC_ERROR if the rings or the generators' buffers could not
+            be allocated
+*/
+int pool_generate(ChainPool *pool, const EnsembleParams *params,
+	Point3D dirs[], int dirs_len, int dim);
+
+/*  Fill the pool with every chain of the ensemble file at path
+
+    Returns:
+        POOL_TRUE on success
+        POOL_IO_ERROR if the file could not be read
+        POOL_FORMAT_ERROR if it is not an ensemble file of equal-length chains
+        POOL_MALLOC_ERROR if the rings could not be allocated
+*/
+int pool_load(ChainPool *pool, const char *path);
+
+void pool_destroy(ChainPool *pool);
+
+static inline const Point3D *pool_ring(const ChainPool *pool, int k)
+{
+	return pool->rings + (size_t)k * pool->N;
+}
+
+/* Write the copy draw describes into out, which must hold N points */
+void pool_transform(const ChainPool *pool, const PoolDraw *draw, Point3D out[]);
+
+/* Write a uniformly random copy into out and return which one it was */
+PoolDraw pool_draw(const ChainPool *pool, Point3D out[],
+	threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+#endif /* POOL_H_ */
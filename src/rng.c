@@ -0,0 +1,90 @@
+#include "rng.h"
+
+#if defined(__AVX512F__)
+#define RNG_LANES 16
+#elif defined(__AVX2__)
+#define RNG_LANES 8
+#else
+#define RNG_LANES 4 /* SSE2 or NEON; GCC lowers it to scalar code elsewhere */
+#endif
+
+typedef uint32_t vuint32 __attribute__((vector_size(RNG_LANES * sizeof(uint32_t))));
+
+/* Threefry-2x32 rotation constants, cycled through every 8 rounds */
+static const int ROTATIONS[8] = {13, 15, 26, 6, 17, 29, 16, 24};
+
+#define THREEFRY_PARITY 0x1BD11BDAu
+#define THREEFRY_ROUNDS 20
+
+/* PRIVATE FUNCTIONS */
+static inline vuint32 __rotl(vuint32 x, int r);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+void threefry2x32_batch(threefry2x32_key_t key, threefry2x32_ctr_t first,
+	int num_blocks, uint32_t out[])
+{
+	const uint32_t ks[3] = {key.v[0], key.v[1], THREEFRY_PARITY ^ key.v[0] ^ key.v[1]};
+	vuint32 lane;
+	for (int l = 0; l < RNG_LANES; l++) lane[l] = (uint32_t)l;
+
+	int j = 0;
+	for (; j + RNG_LANES <= num_blocks; j += RNG_LANES)
+	{
+		vuint32 x0 = first.v[0] + (uint32_t)j + lane + ks[0];
+		vuint32 x1 = (vuint32){0} + first.v[1] + ks[1];
+		// fully unrolled, so every rotation and injection is a constant
+#pragma GCC unroll 20
+		for (int r = 0; r < THREEFRY_ROUNDS; r++)
+		{
+			x0 += x1;
+			x1 = __rotl(x1, ROTATIONS[r % 8]);
+			x1 ^= x0;
+			if (r % 4 == 3)
+			{
+				// key injection s after every fourth round
+				uint32_t s = (uint32_t)r / 4 + 1;
+				x0 += ks[s % 3];
+				x1 += ks[(s + 1) % 3] + s;
+			}
+		}
+		for (int l = 0; l < RNG_LANES; l++)
+		{
+			out[2 * (j + l)] = x0[l];
+			out[2 * (j + l) + 1] = x1[l];
+		}
+	}
+	for (; j < num_blocks; j++)
+	{
+		threefry2x32_ctr_t ctr = {{first.v[0] + (uint32_t)j, first.v[1]}};
+		threefry2x32_ctr_t rand = threefry2x32(ctr, key);
+		out[2 * j] = rand.v[0];
+		out[2 * j + 1] = rand.v[1];
+	}
+}
+
+void rng_init(RngStream *rng, threefry2x32_ctr_t ctr, threefry2x32_key_t key)
+{
+	rng->key = key;
+	rng->ctr = ctr;
+	rng->pos = 2 * RNG_BLOCKS;
+}
+
+void rng_refill(RngStream *rng)
+{
+	threefry2x32_ctr_t next = {{rng->ctr.v[0] + 1, rng->ctr.v[1]}};
+	threefry2x32_batch(rng->key, next, RNG_BLOCKS, rng->buf);
+	rng->ctr.v[0] += RNG_BLOCKS;
+	rng->pos = 0;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static inline vuint32 __rotl(vuint32 x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
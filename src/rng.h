@@ -0,0 +1,78 @@
+#ifndef RNG_H_
+#define RNG_H_
+
+#include <stdint.h>
+#include "numerics.h"
+
+#define RNG_BLOCKS 64 /* threefry blocks generated per refill */
+
+/*
+ * Buffered Threefry-2x32-20 stream.
+ *
+ * rand_u32 and friends run the block cipher once per draw and keep one of
+ * its two output words. An RngStream instead encrypts RNG_BLOCKS consecutive
+ * counters at a time, several per instruction (see threefry2x32_batch), and
+ * hands out both words of every block: word 2j and 2j + 1 of a stream
+ * started at ctr are the two words of block {ctr.v[0] + 1 + j, ctr.v[1]}.
+ * Like rand_u32, the stream only advances ctr.v[0], so the counter layouts
+ * built on ensemble_stream carry over.
+ *
+ * Bounded integers use Lemire's multiply-and-reject, so they are exactly
+ * uniform without a division on the common path.
+ */
+typedef struct
+{
+	threefry2x32_key_t key;
+	threefry2x32_ctr_t ctr;      /* last block in buf */
+	int pos;                     /* next word of buf; 2 * RNG_BLOCKS once used up */
+	uint32_t buf[2 * RNG_BLOCKS];
+} RngStream, rng_stream;
+
+/*
+ * Encrypt the num_blocks counters {first.v[0] + j, first.v[1]} into
+ * out[2j], out[2j + 1]: bit for bit what threefry2x32 gives, 16, 8 or 4
+ * blocks at a time with AVX-512, AVX2 or SSE2/NEON and in scalar code on
+ * other targets.
+ */
+void threefry2x32_batch(threefry2x32_key_t key, threefry2x32_ctr_t first,
+	int num_blocks, uint32_t out[]);
+
+/* Start a stream at ctr; its first block is ctr.v[0] + 1 */
+void rng_init(RngStream *rng, threefry2x32_ctr_t ctr, threefry2x32_key_t key);
+
+/* Refill buf from the next RNG_BLOCKS counters; for rng_u32 */
+void rng_refill(RngStream *rng);
+
+static inline uint32_t rng_u32(RngStream *rng)
+{
+	if (rng->pos == 2 * RNG_BLOCKS) rng_refill(rng);
+	return rng->buf[rng->pos++];
+}
+
+/* Uniform in [0, n), n > 0, without bias */
+static inline uint32_t rng_below(RngStream *rng, uint32_t n)
+{
+	uint64_t m = (uint64_t)rng_u32(rng) * n;
+	if ((uint32_t)m < n)
+	{
+		// the low word falls in the short part of a bucket: redraw the
+		// 2^32 mod n values that would make some results likelier
+		uint32_t threshold = -n % n;
+		while ((uint32_t)m < threshold) m = (uint64_t)rng_u32(rng) * n;
+	}
+	return (uint32_t)(m >> 32);
+}
+
+/* Uniform in [a, b), a < b */
+static inline int rng_int(RngStream *rng, int a, int b)
+{
+	return a + (int)rng_below(rng, (uint32_t)b - (uint32_t)a);
+}
+
+/* Uniform in [a, b) */
+static inline float rng_flt(RngStream *rng, float a, float b)
+{
+	return (b - a) * u01fixedpt_closed_open_32_float(rng_u32(rng)) + a;
+}
+
+#endif /* RNG_H_ */
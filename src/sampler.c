@@ -0,0 +1,93 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "sampler.h"
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int alias_init(AliasTable *table, int capacity)
+{
+	assert(capacity > 0);
+	table->prob = (float *)malloc(capacity * sizeof(float));
+	table->alias = (int *)malloc(capacity * sizeof(int));
+	table->work = (int *)malloc(capacity * sizeof(int));
+	table->owned = true;
+	table->capacity = capacity;
+	table->n = 0;
+	if (table->prob == NULL || table->alias == NULL || table->work == NULL)
+	{
+		alias_destroy(table);
+		return SAMPLER_MALLOC_ERROR;
+	}
+	return SAMPLER_TRUE;
+}
+
+void alias_bind(AliasTable *table, int capacity, float prob[], int alias[], int work[])
+{
+	table->prob = prob;
+	table->alias = alias;
+	table->work = work;
+	table->owned = false;
+	table->capacity = capacity;
+	table->n = 0;
+}
+
+void alias_destroy(AliasTable *table)
+{
+	if (table->owned)
+	{
+		free(table->prob);
+		free(table->alias);
+		free(table->work);
+	}
+	table->prob = NULL;
+	table->alias = NULL;
+	table->work = NULL;
+	table->capacity = 0;
+	table->n = 0;
+}
+
+/*
+ * Vose's method. Columns are scaled so the average is 1; work holds the
+ * under-full columns as a stack growing up from 0 and the over-full ones as a
+ * stack growing down from n - 1. Each under-full column is topped up by an
+ * over-full one, which becomes its alias.
+ */
+void alias_build(AliasTable *table, const float weights[], int n)
+{
+	assert(n > 0 && n <= table->capacity);
+	table->n = n;
+	float sum = 0.0;
+	for (int i = 0; i < n; i++) sum += weights[i];
+	assert(sum > 0.0);
+
+	int num_small = 0, num_large = 0;
+	for (int i = 0; i < n; i++)
+	{
+		table->prob[i] = weights[i] * n / sum;
+		table->alias[i] = i;
+		if (table->prob[i] < 1.0) table->work[num_small++] = i;
+		else table->work[n - 1 - num_large++] = i;
+	}
+	while (num_small > 0 && num_large > 0)
+	{
+		int small = table->work[--num_small];
+		int large = table->work[n - num_large];
+		table->alias[small] = large;
+		table->prob[large] += table->prob[small] - 1.0;
+		if (table->prob[large] < 1.0)
+		{
+			num_large--;
+			table->work[num_small++] = large;
+		}
+	}
+	// whatever is left over is full up to rounding error
+	while (num_small > 0) table->prob[table->work[--num_small]] = 1.0;
+	while (num_large > 0) table->prob[table->work[n - num_large--]] = 1.0;
+}
+
+int alias_draw(const AliasTable *table, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	return alias_pick(table, rand_u32(ctr, key));
+}
@@ -0,0 +1,67 @@
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#include <stdint.h>
+#include "numerics.h"
+
+#define SAMPLER_TRUE 0
+#define SAMPLER_MALLOC_ERROR -2
+
+/*
+ * Walker/Vose alias table: after an O(n) build, drawing an index i with
+ * probability weights[i] / sum(weights) costs one random word and one
+ * comparison, however many outcomes there are.
+ *
+ * Tables either own their storage (alias_init / alias_destroy) or borrow
+ * caller-provided arrays of n entries each (alias_bind), which lets hot
+ * paths with a handful of outcomes build their table on the stack.
+ */
+typedef struct
+{
+	int n;
+	int capacity;
+	float *prob; /* probability of keeping column i rather than its alias */
+	int *alias;
+	int *work;   /* scratch for the build */
+	bool owned;
+} AliasTable, alias_table;
+
+/*  Allocate a table for up to capacity outcomes
+
+    Returns:
+        SAMPLER_MALLOC_ERROR: If an error occured setting up the memory
+        SAMPLER_TRUE: On success
+*/
+int alias_init(AliasTable *table, int capacity);
+
+/* Use the caller's arrays (capacity entries each) as the table's storage */
+void alias_bind(AliasTable *table, int capacity, float prob[], int alias[], int work[]);
+
+void alias_destroy(AliasTable *table);
+
+/*
+ * Build the table for weights[0..n-1] (n <= capacity). Weights need not be
+ * normalized but must be non-negative with a positive sum.
+ */
+void alias_build(AliasTable *table, const float weights[], int n);
+
+/* Draw an index in [0, n) with the built distribution */
+int alias_draw(const AliasTable *table, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
+
+/* alias_draw with the random word u supplied, e.g. from an RngStream */
+static inline int alias_pick(const AliasTable *table, uint32_t u)
+{
+	// the high bits of u * n pick the column, the low bits are the coin flip
+	uint64_t scaled = (uint64_t)u * (uint64_t)table->n;
+	int column = (int)(scaled >> 32);
+	float coin = (float)(uint32_t)scaled * 0x1p-32f;
+	return coin < table->prob[column] ? column : table->alias[column];
+}
+
+/* Draw an index in [0, n) uniformly: one random word, no division */
+static inline int uniform_index(int n, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
+{
+	return (int)(((uint64_t)rand_u32(ctr, key) * (uint64_t)n) >> 32);
+}
+
+#endif /* SAMPLER_H_ */
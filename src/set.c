@@ -13,17 +13,34 @@
 #include <string.h>
 #include <stdlib.h>
 #include "set.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-#define MAX_FULLNESS_PERCENT 0.25       /* arbitrary */
+#define GROUP_WIDTH 16                  /* control bytes scanned per probe step */
+#define MIN_SLOTS GROUP_WIDTH
+
+/* control bytes: full slots hold the low 7 bits of their hash instead */
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE               /* also marks slots a rehash has yet to move */
 
 /* PRIVATE FUNCTIONS */
 static uint64_t __default_hash(const Point3D *key);
+static Point3D __canonical(const Point3D *key);
+static bool __key_equal(const Point3D *a, const Point3D *b);
+static uint64_t __max_load(uint64_t number_slots);
+static uint32_t __match_byte(const uint8_t *group, uint8_t byte);
+static uint32_t __match_free(const uint8_t *group);
+static void __set_ctrl(PointSet *set, uint64_t index, uint8_t ctrl);
 static int __get_index(PointSet *set, const Point3D *key, uint64_t hash, uint64_t *index);
-static int __assign_node(PointSet *set, const Point3D *key, uint64_t hash, uint64_t index);
-static void __free_index(PointSet *set, uint64_t index);
-static int __set_contains(PointSet *set, const Point3D *key, uint64_t hash);
-static int __set_add(PointSet *set, const Point3D *key, uint64_t hash);
-static void __relayout_nodes(PointSet *set, uint64_t start, short end_on_null);
+static uint64_t __find_free(PointSet *set, uint64_t hash);
+static int __assign_slot(PointSet *set, const Point3D *key, uint64_t hash, uint64_t index);
+static uint64_t __hash_from(const PointSet *set, const PointSet *src, uint64_t element);
+static int __set_contains_hashed(PointSet *set, const Point3D *key, uint64_t hash);
+static int __set_add_hashed(PointSet *set, const Point3D *key, uint64_t hash);
+static int __reserve_elements(PointSet *set, uint64_t num_keys);
+static int __rehash(PointSet *set, uint64_t number_slots);
+static bool __same_box(const PointBitset *b1, const PointBitset *b2);
 
 /*******************************************************************************
                              FUNCTION DEFINITIONS
@@ -31,98 +48,140 @@ static void __relayout_nodes(PointSet *set, uint64_t start, short end_on_null);
 
 int set_init_alt(PointSet *set, uint64_t num_els, set_hash_function hash)
 {
-    set->nodes = (point_set_node**) malloc(num_els * sizeof(point_set_node*));
-    if (set->nodes == NULL) return SET_MALLOC_ERROR;
-    set->number_nodes = num_els;
-    for (uint64_t i = 0; i < set->number_nodes; ++i) set->nodes[i] = NULL;
-    set->used_nodes = 0;
+    uint64_t num_slots = MIN_SLOTS;
+    while (num_slots < num_els) num_slots <<= 1;
+    set->ctrl = (uint8_t *)malloc(num_slots + GROUP_WIDTH);
+    set->slots = (point_set_slot *)malloc(num_slots * sizeof(point_set_slot));
+    if (set->ctrl == NULL || set->slots == NULL)
+	{
+        free(set->ctrl);
+        free(set->slots);
+        return SET_MALLOC_ERROR;
+    }
+    set->number_slots = num_slots;
+    memset(set->ctrl, CTRL_EMPTY, num_slots + GROUP_WIDTH);
+    set->used_slots = 0;
+    set->deleted_slots = 0;
     set->hash_function = (hash == NULL) ? &__default_hash : hash;
+    set->elements = NULL;
+    set->element_slots = NULL;
+    set->element_hashes = NULL;
+    set->number_elements = 0;
     return SET_TRUE;
 }
 
 int set_clear(PointSet *set)
 {
-    for(uint64_t i = 0; i < set->number_nodes; ++i)
-	{
-        if (set->nodes[i] != NULL) __free_index(set, i);
-    }
-    set->used_nodes = 0;
+    memset(set->ctrl, CTRL_EMPTY, set->number_slots + GROUP_WIDTH);
+    set->used_slots = 0;
+    set->deleted_slots = 0;
     return SET_TRUE;
 }
 
 int set_destroy(PointSet *set)
 {
-    set_clear(set);
-    free(set->nodes);
-    set->number_nodes = 0;
-    set->used_nodes = 0;
+    free(set->ctrl);
+    free(set->slots);
+    free(set->elements);
+    free(set->element_slots);
+    free(set->element_hashes);
+    set->ctrl = NULL;
+    set->slots = NULL;
+    set->elements = NULL;
+    set->element_slots = NULL;
+    set->element_hashes = NULL;
+    set->number_elements = 0;
+    set->number_slots = 0;
+    set->used_slots = 0;
+    set->deleted_slots = 0;
     set->hash_function = NULL;
     return SET_TRUE;
 }
 
 int set_add(PointSet *set, const Point3D *key)
 {
-    uint64_t hash = set->hash_function(key);
-    return __set_add(set, key, hash);
+    Point3D canonical = __canonical(key);
+    return __set_add_hashed(set, &canonical, set->hash_function(&canonical));
+}
+
+int set_reserve(PointSet *set, uint64_t num_keys)
+{
+    uint64_t num_slots = set->number_slots;
+    while (__max_load(num_slots) < num_keys) num_slots <<= 1;
+    if (num_slots != set->number_slots && __rehash(set, num_slots) != SET_TRUE) return SET_MALLOC_ERROR;
+    return __reserve_elements(set, num_keys);
 }
 
 int set_remove(PointSet *set, const Point3D *key)
 {
-    uint64_t index, hash = set->hash_function(key);
-    int pos = __get_index(set, key, hash, &index);
+    Point3D canonical = __canonical(key);
+    uint64_t index;
+    int pos = __get_index(set, &canonical, set->hash_function(&canonical), &index);
     if (pos != SET_TRUE) return pos;
-    // remove this node
-    __free_index(set, index);
-    // re-layout nodes
-    __relayout_nodes(set, index, 0);
-    --set->used_nodes;
+    // fill the removed key's place in the dense array with the last key
+    uint64_t element = set->slots[index]._element, last = set->used_slots - 1;
+    if (element != last)
+	{
+        set->elements[element] = set->elements[last];
+        set->element_slots[element] = set->element_slots[last];
+        set->element_hashes[element] = set->element_hashes[last];
+        set->slots[set->element_slots[element]]._element = (uint32_t)element;
+    }
+    // leave a tombstone so probe runs through this slot stay unbroken
+    __set_ctrl(set, index, CTRL_DELETED);
+    ++set->deleted_slots;
+    --set->used_slots;
     return SET_TRUE;
 }
 
 int set_contains(PointSet *set, const Point3D *key)
 {
-    uint64_t index, hash = set->hash_function(key);
-    return __get_index(set, key, hash, &index);
+    Point3D canonical = __canonical(key);
+    return __set_contains_hashed(set, &canonical, set->hash_function(&canonical));
 }
 
 uint64_t set_length(PointSet *set)
 {
-    return set->used_nodes;
+    return set->used_slots;
 }
 
+/*
+   NOTE: the bulk operations walk the sources' dense element arrays rather
+  		 than every slot, hand the result each key's stored hash when both
+  		 sets hash alike, and size the result once up front.
+ */
 int set_union(PointSet *res, PointSet *s1, PointSet *s2)
 {
-    if (res->used_nodes != 0) return SET_OCCUPIED_ERROR;
-    // loop over both s1 and s2 and get keys and insert them into res
-    for (uint64_t i = 0; i < s1->number_nodes; ++i)
+    if (res->used_slots != 0) return SET_OCCUPIED_ERROR;
+    if (set_reserve(res, s1->used_slots + s2->used_slots) != SET_TRUE) return SET_MALLOC_ERROR;
+    // loop over both s1 and s2 and insert their keys into res
+    for (uint64_t e = 0; e < s1->used_slots; ++e)
 	{
-        if (s1->nodes[i] != NULL)
-		{
-            __set_add(res, s1->nodes[i]->_key, s1->nodes[i]->_hash);
-        }
+        __set_add_hashed(res, &s1->elements[e], __hash_from(res, s1, e));
     }
-    for (uint64_t i = 0; i < s2->number_nodes; ++i)
+    for (uint64_t e = 0; e < s2->used_slots; ++e)
 	{
-        if (s2->nodes[i] != NULL)
-		{
-            __set_add(res, s2->nodes[i]->_key, s2->nodes[i]->_hash);
-        }
+        __set_add_hashed(res, &s2->elements[e], __hash_from(res, s2, e));
     }
     return SET_TRUE;
 }
 
 int set_intersection(PointSet *res, PointSet *s1, PointSet *s2)
 {
-    if (res->used_nodes != 0) return SET_OCCUPIED_ERROR;
-    // loop over both one of s1 and s2: get keys, check the other, and insert them into res if it is
-    for (uint64_t i = 0; i < s1->number_nodes; ++i)
+    if (res->used_slots != 0) return SET_OCCUPIED_ERROR;
+    // loop over the smaller set and keep what the other has too
+    if (s2->used_slots < s1->used_slots)
 	{
-        if (s1->nodes[i] != NULL)
+        PointSet *tmp = s1;
+        s1 = s2;
+        s2 = tmp;
+    }
+    if (set_reserve(res, s1->used_slots) != SET_TRUE) return SET_MALLOC_ERROR;
+    for (uint64_t e = 0; e < s1->used_slots; ++e)
+	{
+        if (__set_contains_hashed(s2, &s1->elements[e], __hash_from(s2, s1, e)) == SET_TRUE)
 		{
-            if (__set_contains(s2, s1->nodes[i]->_key, s1->nodes[i]->_hash) == SET_TRUE)
-			{
-                __set_add(res, s1->nodes[i]->_key, s1->nodes[i]->_hash);
-            }
+            __set_add_hashed(res, &s1->elements[e], __hash_from(res, s1, e));
         }
     }
     return SET_TRUE;
@@ -131,19 +190,17 @@ int set_intersection(PointSet *res, PointSet *s1, PointSet *s2)
 /* difference is s1 - s2 */
 int set_difference(PointSet *res, PointSet *s1, PointSet *s2)
 {
-    if (res->used_nodes != 0)
+    if (res->used_slots != 0)
 	{
         return SET_OCCUPIED_ERROR;
     }
+    if (set_reserve(res, s1->used_slots) != SET_TRUE) return SET_MALLOC_ERROR;
     // loop over s1 and keep only things not in s2
-    for (uint64_t i = 0; i < s1->number_nodes; ++i)
+    for (uint64_t e = 0; e < s1->used_slots; ++e)
 	{
-        if (s1->nodes[i] != NULL)
+        if (__set_contains_hashed(s2, &s1->elements[e], __hash_from(s2, s1, e)) != SET_TRUE)
 		{
-            if (__set_contains(s2, s1->nodes[i]->_key, s1->nodes[i]->_hash) != SET_TRUE)
-			{
-                __set_add(res, s1->nodes[i]->_key, s1->nodes[i]->_hash);
-            }
+            __set_add_hashed(res, &s1->elements[e], __hash_from(res, s1, e));
         }
     }
     return SET_TRUE;
@@ -151,27 +208,22 @@ int set_difference(PointSet *res, PointSet *s1, PointSet *s2)
 
 int set_symmetric_difference(PointSet *res, PointSet *s1, PointSet *s2) 
 {
-    if (res->used_nodes != 0) return SET_OCCUPIED_ERROR;
+    if (res->used_slots != 0) return SET_OCCUPIED_ERROR;
+    if (set_reserve(res, s1->used_slots + s2->used_slots) != SET_TRUE) return SET_MALLOC_ERROR;
     // loop over set 1 and add elements that are unique to set 1
-    for (uint64_t i = 0; i < s1->number_nodes; ++i)
+    for (uint64_t e = 0; e < s1->used_slots; ++e)
 	{
-        if (s1->nodes[i] != NULL)
+        if (__set_contains_hashed(s2, &s1->elements[e], __hash_from(s2, s1, e)) != SET_TRUE)
 		{
-            if (__set_contains(s2, s1->nodes[i]->_key, s1->nodes[i]->_hash) != SET_TRUE)
-			{
-                __set_add(res, s1->nodes[i]->_key, s1->nodes[i]->_hash);
-            }
+            __set_add_hashed(res, &s1->elements[e], __hash_from(res, s1, e));
         }
     }
     // loop over set 2 and add elements that are unique to set 2
-    for (uint64_t i = 0; i < s2->number_nodes; ++i)
+    for (uint64_t e = 0; e < s2->used_slots; ++e)
 	{
-        if (s2->nodes[i] != NULL)
+        if (__set_contains_hashed(s1, &s2->elements[e], __hash_from(s1, s2, e)) != SET_TRUE)
 		{
-            if (__set_contains(s1, s2->nodes[i]->_key, s2->nodes[i]->_hash) != SET_TRUE)
-			{
-                __set_add(res, s2->nodes[i]->_key, s2->nodes[i]->_hash);
-            }
+            __set_add_hashed(res, &s2->elements[e], __hash_from(res, s2, e));
         }
     }
     return SET_TRUE;
@@ -179,14 +231,12 @@ int set_symmetric_difference(PointSet *res, PointSet *s1, PointSet *s2)
 
 int set_is_subset(PointSet *test, PointSet *against)
 {
-    for (uint64_t i = 0; i < test->number_nodes; ++i)
+    if (test->used_slots > against->used_slots) return SET_FALSE;
+    for (uint64_t e = 0; e < test->used_slots; ++e)
 	{
-        if (test->nodes[i] != NULL)
+        if (__set_contains_hashed(against, &test->elements[e], __hash_from(against, test, e)) != SET_TRUE)
 		{
-            if (__set_contains(against, test->nodes[i]->_key, test->nodes[i]->_hash) == SET_FALSE)
-			{
-                return SET_FALSE;
-            }
+            return SET_FALSE;
         }
     }
     return SET_TRUE;
@@ -194,41 +244,31 @@ int set_is_subset(PointSet *test, PointSet *against)
 
 int set_is_subset_strict(PointSet *test, PointSet *against)
 {
-    if (test->used_nodes >= against->used_nodes) return SET_FALSE;
+    if (test->used_slots >= against->used_slots) return SET_FALSE;
     return set_is_subset(test, against);
 }
 
 int set_cmp(PointSet *left, PointSet *right)
 {
-    if (left->used_nodes < right->used_nodes)
+    if (left->used_slots < right->used_slots)
 	{
         return SET_RIGHT_GREATER;
     }
-	else if (right->used_nodes < left->used_nodes)
+	else if (right->used_slots < left->used_slots)
 	{
         return SET_LEFT_GREATER;
     }
-    for (uint64_t i = 0; i < left->number_nodes; ++i)
-	{
-        if (left->nodes[i] != NULL)
-		{
-            if (set_contains(right, left->nodes[i]->_key) != SET_TRUE)
-			{
-                return SET_UNEQUAL;
-            }
-        }
-    }
-    return SET_EQUAL;
+    return set_is_subset(left, right) == SET_TRUE ? SET_EQUAL : SET_UNEQUAL;
 }
 
 // FIXME
 int set_to_str(PointSet *set, char result[])
 {
-    for (uint64_t i = 0; i < set->number_nodes; ++i)
+    for (uint64_t i = 0; i < set->number_slots; ++i)
 	{
-		if (set->nodes[i] != NULL)
+		if (set->ctrl[i] < CTRL_EMPTY)
 		{
-			char *node_str = pt_to_str(*(set->nodes[i]->_key));
+			char *node_str = pt_to_str(set->slots[i]._key);
 			strcat(result, node_str);
 			strcat(result, "\n");
 			if (node_str) free(node_str);
@@ -245,11 +285,11 @@ int set_to_str(PointSet *set, char result[])
 
 int print_set(PointSet *set)
 {
-	for (uint64_t i = 0; i < set->number_nodes; ++i)
+	for (uint64_t i = 0; i < set->number_slots; ++i)
 	{
-		if (set->nodes[i] != NULL)
+		if (set->ctrl[i] < CTRL_EMPTY)
 		{
-			print_pt(*(set->nodes[i]->_key));
+			print_pt(set->slots[i]._key);
 		}
 	}
 	return SET_TRUE;
@@ -271,40 +311,115 @@ int chain_to_set(Point3D chain[], int N, PointSet *set)
 
 Point3D set_rand_choice(PointSet *set, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key)
 {
-	// not sure if we can, uh, do this...
-	float probs[set->used_nodes];
-	// for now, choose an element with uniform probability
-	// TODO: add support for generic pdf
-	for (int i = 0; i < set->used_nodes; i++)
+	assert(set->used_slots > 0);
+	return set->elements[uniform_index((int)set->used_slots, ctr, key)];
+}
+
+int set_bitset_init(PointBitset *bits, const LatticePoint *min, const LatticePoint *max)
+{
+    assert(min->x <= max->x && min->y <= max->y && min->z <= max->z);
+    bits->min = *min;
+    bits->nx = max->x - min->x + 1;
+    bits->ny = max->y - min->y + 1;
+    bits->nz = max->z - min->z + 1;
+    uint64_t num_sites = (uint64_t)bits->nx * bits->ny * bits->nz;
+    bits->number_words = (num_sites + 63) / 64;
+    bits->words = (uint64_t *)calloc(bits->number_words, sizeof(uint64_t));
+    if (bits->words == NULL)
 	{
-		probs[i] = 1.0 / set->used_nodes;	
-	}
-	float cum_prob[set->used_nodes];
-	float accum = 0.0;
-	for (int i = 0; i < set->used_nodes; i++)
+        bits->number_words = 0;
+        return SET_MALLOC_ERROR;
+    }
+    return SET_TRUE;
+}
+
+void set_bitset_destroy(PointBitset *bits)
+{
+    free(bits->words);
+    bits->words = NULL;
+    bits->number_words = 0;
+}
+
+void set_bitset_clear(PointBitset *bits)
+{
+    memset(bits->words, 0, bits->number_words * sizeof(uint64_t));
+}
+
+uint64_t set_bitset_length(const PointBitset *bits)
+{
+    uint64_t count = 0;
+    for (uint64_t w = 0; w < bits->number_words; w++)
 	{
-		accum += probs[i];
-		cum_prob[i] = accum;
-	}
-	assert(flt_near_eq(accum, 1.0, EPS));
+        count += (uint64_t)__builtin_popcountll(bits->words[w]);
+    }
+    return count;
+}
 
-	float rand_val = rand_flt(ctr, key, 0.0, 1.0);
-	Point3D return_val;
-	pt_init(&return_val);
-	int prob_ctr = 0; /* need sep counter as we loop over all nodes, not just used */
-    for (uint64_t i = 0; i < set->number_nodes; ++i)
+int set_to_bitset(PointBitset *bits, PointSet *set)
+{
+    int res = SET_TRUE;
+    set_bitset_clear(bits);
+    for (uint64_t e = 0; e < set->used_slots; e++)
+	{
+        if (set_bitset_add(bits, &set->elements[e]) != SET_TRUE) res = SET_FALSE;
+    }
+    return res;
+}
+
+int set_from_bitset(PointSet *set, const PointBitset *bits)
+{
+    if (set_reserve(set, set->used_slots + set_bitset_length(bits)) != SET_TRUE) return SET_MALLOC_ERROR;
+    for (uint64_t w = 0; w < bits->number_words; w++)
 	{
-		if (set->nodes[i] != NULL)
+        for (uint64_t word = bits->words[w]; word != 0; word &= word - 1)
 		{
-			if (flt_less_than(rand_val, cum_prob[prob_ctr], EPS))
-			{
-				pt_copy(set->nodes[i]->_key, &return_val);
-				break;
-			}
-			prob_ctr++;
-		}
-	}	
-	return return_val;
+            uint64_t index = w * 64 + (uint64_t)__builtin_ctzll(word);
+            LatticePoint p = {
+                bits->min.x + (int32_t)(index % bits->nx),
+                bits->min.y + (int32_t)(index / bits->nx % bits->ny),
+                bits->min.z + (int32_t)(index / bits->nx / bits->ny)
+            };
+            Point3D key = lat_to_pt(&p);
+            if (set_add(set, &key) == SET_MALLOC_ERROR) return SET_MALLOC_ERROR;
+        }
+    }
+    return SET_TRUE;
+}
+
+int set_bitset_union(PointBitset *res, const PointBitset *b1, const PointBitset *b2)
+{
+    if (!__same_box(res, b1) || !__same_box(b1, b2)) return SET_FALSE;
+    for (uint64_t w = 0; w < res->number_words; w++) res->words[w] = b1->words[w] | b2->words[w];
+    return SET_TRUE;
+}
+
+int set_bitset_intersection(PointBitset *res, const PointBitset *b1, const PointBitset *b2)
+{
+    if (!__same_box(res, b1) || !__same_box(b1, b2)) return SET_FALSE;
+    for (uint64_t w = 0; w < res->number_words; w++) res->words[w] = b1->words[w] & b2->words[w];
+    return SET_TRUE;
+}
+
+int set_bitset_difference(PointBitset *res, const PointBitset *b1, const PointBitset *b2)
+{
+    if (!__same_box(res, b1) || !__same_box(b1, b2)) return SET_FALSE;
+    for (uint64_t w = 0; w < res->number_words; w++) res->words[w] = b1->words[w] & ~b2->words[w];
+    return SET_TRUE;
+}
+
+int set_bitset_symmetric_difference(PointBitset *res, const PointBitset *b1, const PointBitset *b2)
+{
+    if (!__same_box(res, b1) || !__same_box(b1, b2)) return SET_FALSE;
+    for (uint64_t w = 0; w < res->number_words; w++) res->words[w] = b1->words[w] ^ b2->words[w];
+    return SET_TRUE;
+}
+
+int set_bitset_is_subset(const PointBitset *test, const PointBitset *against)
+{
+    if (!__same_box(test, against)) return SET_FALSE;
+    uint64_t outside = 0;
+    for (uint64_t w = 0; w < test->number_words; w++) outside |= test->words[w] & ~against->words[w];
+    return outside == 0 ? SET_TRUE : SET_FALSE;
 }
 
 //char** set_to_array(PointSet *set, uint64_t *size) {
@@ -313,10 +428,10 @@ Point3D set_rand_choice(PointSet *set, threefry2x32_ctr_t *ctr, threefry2x32_key
 //    uint64_t i, j = 0;
 //    size_t len;
 //    for (i = 0; i < set->number_nodes; ++i) {
-//        if (set->nodes[i] != NULL) {
-//            len = strlen(set->nodes[i]->_key);
+//        if (set->ctrl[i] < CTRL_EMPTY) {
+//            len = strlen(&set->slots[i]._key);
 //            results[j] = (char*)calloc(len + 1, sizeof(char));
-//            memcpy(results[j], set->nodes[i]->_key, len);
+//            memcpy(results[j], &set->slots[i]._key, len);
 //            ++j;
 //        }
 //    }
@@ -327,161 +442,235 @@ Point3D set_rand_choice(PointSet *set, threefry2x32_ctr_t *ctr, threefry2x32_key
         					    PRIVATE FUNCTIONS
 *******************************************************************************/
 /*
-   NOTE: this function looks a little bit clunky now because it now supports
-  		 keys of type Point3D (struct point3d). So we have to iterate over
-  		 every byte in each of the three float values which constitute the
-  		 Point3D type.
+   NOTE: keys are hashed as their three coordinates' bits, two words through
+  		 one multiply each and a 64-bit finalizer, instead of feeding twelve
+  		 bytes through FNV-1a one at a time or rounding them to a LatticeKey.
  */
 static uint64_t __default_hash(const Point3D *key)
 {
-    // FNV-1a hash (http://www.isthe.com/chongo/tech/comp/fnv/)
-	unsigned char key_x_in_bytes[4];
-	unsigned char key_y_in_bytes[4];
-	unsigned char key_z_in_bytes[4];
-	flt_to_bytes(key_x_in_bytes, key->x);
-	flt_to_bytes(key_y_in_bytes, key->y);
-	flt_to_bytes(key_z_in_bytes, key->z);
+    uint64_t xy, z;
+    uint32_t bits;
+    memcpy(&xy, key, sizeof(xy));
+    memcpy(&bits, (const char *)key + sizeof(xy), sizeof(bits));
+    z = bits;
+    return lat_key_hash(xy * 0x9E3779B97F4A7C15ULL ^ z * 0xC2B2AE3D27D4EB4FULL);
+}
+
+/* key with -0.0 coordinates turned into 0.0, so equal sites have equal bits */
+static Point3D __canonical(const Point3D *key)
+{
+    Point3D canonical = {key->x + 0.0f, key->y + 0.0f, key->z + 0.0f};
+    return canonical;
+}
 
-    uint64_t h = 14695981039346656037ULL; // FNV_OFFSET 64 bit
-    for (size_t i = 0; i < 4; ++i)
-	{
-        h = h ^ key_x_in_bytes[i];
-        h = h * 1099511628211ULL; // FNV_PRIME 64 bit
-    }
-    for (size_t i = 0; i < 4; ++i)
-	{
-        h = h ^ key_y_in_bytes[i];
-        h = h * 1099511628211ULL; // FNV_PRIME 64 bit
-    }
-    for (size_t i = 0; i < 4; ++i)
-	{
-        h = h ^ key_z_in_bytes[i];
-        h = h * 1099511628211ULL; // FNV_PRIME 64 bit
-    }
-    return h;
+/* 96-bit compare of two canonical keys */
+static bool __key_equal(const Point3D *a, const Point3D *b)
+{
+    uint64_t a_xy, b_xy;
+    uint32_t a_z, b_z;
+    memcpy(&a_xy, a, sizeof(a_xy));
+    memcpy(&b_xy, b, sizeof(b_xy));
+    memcpy(&a_z, (const char *)a + sizeof(a_xy), sizeof(a_z));
+    memcpy(&b_z, (const char *)b + sizeof(b_xy), sizeof(b_z));
+    return ((a_xy ^ b_xy) | (a_z ^ b_z)) == 0;
+}
+
+/* full plus deleted slots allowed before a rehash: 7/8 of the table */
+static uint64_t __max_load(uint64_t number_slots)
+{
+    return number_slots - number_slots / 8;
+}
+
+/* bit i set iff group[i] == byte */
+static uint32_t __match_byte(const uint8_t *group, uint8_t byte)
+{
+#if defined(__SSE2__)
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)(const void *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; ++i) mask |= (uint32_t)(group[i] == byte) << i;
+    return mask;
+#endif
+}
+
+/* bit i set iff group[i] is empty or deleted: the control bytes with the top bit set */
+static uint32_t __match_free(const uint8_t *group)
+{
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; ++i) mask |= (uint32_t)(group[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+/* Write a control byte, and its copy past the end if it is one of the first 16 */
+static void __set_ctrl(PointSet *set, uint64_t index, uint8_t ctrl)
+{
+    set->ctrl[index] = ctrl;
+    if (index < GROUP_WIDTH) set->ctrl[set->number_slots + index] = ctrl;
 }
 
-static int __set_contains(PointSet *set, const Point3D *key, uint64_t hash)
+/* The hash set gives element of src, reusing src's if they hash alike */
+static uint64_t __hash_from(const PointSet *set, const PointSet *src, uint64_t element)
+{
+    if (set->hash_function == src->hash_function) return src->element_hashes[element];
+    return set->hash_function(&src->elements[element]);
+}
+
+static int __set_contains_hashed(PointSet *set, const Point3D *key, uint64_t hash)
 {
     uint64_t index;
     return __get_index(set, key, hash, &index);
 }
 
-static int __set_add(PointSet *set, const Point3D *key, uint64_t hash)
+static int __set_add_hashed(PointSet *set, const Point3D *key, uint64_t hash)
 {
     uint64_t index;
-    if (__set_contains(set, key, hash) == SET_TRUE) return SET_ALREADY_PRESENT;
-
-    // Expand nodes if we are close to our desired fullness
-    if ((float)set->used_nodes / set->number_nodes > MAX_FULLNESS_PERCENT)
-	{
-		uint64_t num_els = set->number_nodes * 2; // we want to double each time
-		point_set_node** tmp = (point_set_node**)realloc(set->nodes, num_els * sizeof(point_set_node*));
-		// malloc failure 
-		if (tmp == NULL || set->nodes == NULL) return SET_MALLOC_ERROR;
-		set->nodes = tmp;
-		uint64_t i, orig_num_els = set->number_nodes;
-		for (i = orig_num_els; i < num_els; ++i) set->nodes[i] = NULL;
-		set->number_nodes = num_els;
-		// re-layout all nodes
-		__relayout_nodes(set, 0, 1);
-    }
-    // add element in
     int res = __get_index(set, key, hash, &index);
-    if (res == SET_FALSE) // this is the first open slot
+    if (res == SET_TRUE) return SET_ALREADY_PRESENT;
+
+    // rehash once live keys and tombstones would pass our desired fullness:
+    // in place if tombstones are most of it, else at double the size
+    if (set->used_slots + set->deleted_slots + 1 > __max_load(set->number_slots))
 	{
-        __assign_node(set, key, hash, index);
-        ++set->used_nodes;
-        return SET_TRUE;
+        uint64_t num_slots = set->number_slots;
+        if (set->used_slots + 1 > __max_load(num_slots) / 2) num_slots *= 2;
+        if (__rehash(set, num_slots) != SET_TRUE) return SET_MALLOC_ERROR;
     }
-	// only other return value options are SET_TRUE or SET_CIRCULAR_ERROR 
-	// so will most of time give same return code if 
-	// we weren't able to add in the element (because we WERE able to return
-	// the index) as if we were able to add in the element. Much lower relative
-	// chance of returning SET_CIRCULAR_ERROR. However, how likely do we hit this
-	// point?
-    return res;
+    index = __find_free(set, hash);
+    if (__assign_slot(set, key, hash, index) != SET_TRUE) return SET_MALLOC_ERROR;
+    ++set->used_slots;
+    return SET_TRUE;
 }
 
-// TODO: test this function as well, as maybe the byte array representations
-// 		 of the floats within a Point3D struct don't align perfectly...
-// 		 ALSO is this implementation better/faster than just using our higher-lvl
-// 		 pt_equal function??
+/*
+   Probe from the group at hash >> 7, sixteen control bytes at a time. Only
+   slots whose byte matches the low 7 bits of the hash get a key compare, and
+   a group with an empty slot ends the search: an insert would have stopped
+   there.
+ */
 static int __get_index(PointSet *set, const Point3D *key, uint64_t hash, uint64_t *index)
 {
-    uint64_t i, idx;
-    idx = hash % set->number_nodes;
-    i = idx;
-	// typecast the input key
-	const char *key_x_in_bytes = (const char *)&(key->x);
-	const char *key_y_in_bytes = (const char *)&(key->y);
-	const char *key_z_in_bytes = (const char *)&(key->z);
-    size_t len_x = strlen(key_x_in_bytes);
-    size_t len_y = strlen(key_y_in_bytes);
-    size_t len_z = strlen(key_z_in_bytes);
-    while (1)
+    uint64_t mask = set->number_slots - 1;
+    uint64_t pos = (hash >> 7) & mask;
+    uint8_t h2 = (uint8_t)(hash & 0x7F);
+    for (uint64_t probed = 0; probed < set->number_slots; probed += GROUP_WIDTH)
 	{
-        if (set->nodes[i] == NULL)
-		{
-            *index = i;
-            return SET_FALSE; // not here OR first open slot
-        }
-		// need to do a similar typecast for the key we're comparing against
-		const char *_node_key_x = (const char *)&(set->nodes[i]->_key->x);
-		const char *_node_key_y = (const char *)&(set->nodes[i]->_key->y);
-		const char *_node_key_z = (const char *)&(set->nodes[i]->_key->z);
-		if (hash == set->nodes[i]->_hash
-			&& len_x == strlen(_node_key_x)
-			&& len_y == strlen(_node_key_y)
-			&& len_z == strlen(_node_key_z)
-			&& (strncmp(key_x_in_bytes, _node_key_x, len_x) == 0)
-			&& (strncmp(key_y_in_bytes, _node_key_y, len_z) == 0)
-			&& (strncmp(key_z_in_bytes, _node_key_z, len_z) == 0))
+        const uint8_t *group = set->ctrl + pos;
+        for (uint32_t match = __match_byte(group, h2); match != 0; match &= match - 1)
 		{
-            *index = i;
-            return SET_TRUE;
+            uint64_t i = (pos + (uint64_t)__builtin_ctz(match)) & mask;
+            if (__key_equal(&set->slots[i]._key, key))
+			{
+                *index = i;
+                return SET_TRUE;
+            }
         }
-        ++i;
-        if (i == set->number_nodes) i = 0;
-		// this means we went all the way around and the set is full
-        if (i == idx) return SET_CIRCULAR_ERROR;
+        if (__match_byte(group, CTRL_EMPTY) != 0) return SET_FALSE;
+        pos = (pos + GROUP_WIDTH) & mask;
     }
+	// this means we went all the way around and the set is full
+    return SET_CIRCULAR_ERROR;
 }
 
-// TODO: test this one out specifically, this was the trickiest alteration
-static int __assign_node(PointSet *set, const Point3D *key, uint64_t hash, uint64_t index)
+/* First empty or deleted slot on hash's probe sequence; the load factor keeps one */
+static uint64_t __find_free(PointSet *set, uint64_t hash)
 {
-    set->nodes[index] = (point_set_node *)malloc(sizeof(point_set_node));
-    set->nodes[index]->_key = (Point3D *)calloc(1, sizeof(Point3D));
-    memcpy(set->nodes[index]->_key, key, sizeof(Point3D));
-    set->nodes[index]->_hash = hash;
+    uint64_t mask = set->number_slots - 1;
+    uint64_t pos = (hash >> 7) & mask;
+    uint32_t match;
+    while ((match = __match_free(set->ctrl + pos)) == 0) pos = (pos + GROUP_WIDTH) & mask;
+    return (pos + (uint64_t)__builtin_ctz(match)) & mask;
+}
+
+static int __assign_slot(PointSet *set, const Point3D *key, uint64_t hash, uint64_t index)
+{
+    // append the key to the dense arrays, doubling them when full
+    if (set->used_slots == set->number_elements
+        && __reserve_elements(set, set->number_elements ? set->number_elements * 2 : 64) != SET_TRUE)
+	{
+        return SET_MALLOC_ERROR;
+    }
+    if (set->ctrl[index] == CTRL_DELETED) --set->deleted_slots;
+    __set_ctrl(set, index, (uint8_t)(hash & 0x7F));
+    set->slots[index]._key = *key;
+    set->slots[index]._element = (uint32_t)set->used_slots;
+    set->elements[set->used_slots] = *key;
+    set->element_slots[set->used_slots] = index;
+    set->element_hashes[set->used_slots] = hash;
     return SET_TRUE;
 }
 
-// NOTE: key now is _key, which is NOT a pointer: do we still want to dealloc
-// 		 it's location in memory?? (I think so, since __assign_node callocs)
-static void __free_index(PointSet *set, uint64_t index)
+/* Grow the dense arrays to hold at least num_keys keys */
+static int __reserve_elements(PointSet *set, uint64_t num_keys)
 {
-    free(&(set->nodes[index]->_key));
-    free(set->nodes[index]);
-    set->nodes[index] = NULL;
+    if (num_keys <= set->number_elements) return SET_TRUE;
+    Point3D *elements = (Point3D *)realloc(set->elements, num_keys * sizeof(Point3D));
+    if (elements == NULL) return SET_MALLOC_ERROR;
+    set->elements = elements;
+    uint64_t *element_slots = (uint64_t *)realloc(set->element_slots, num_keys * sizeof(uint64_t));
+    if (element_slots == NULL) return SET_MALLOC_ERROR;
+    set->element_slots = element_slots;
+    uint64_t *element_hashes = (uint64_t *)realloc(set->element_hashes, num_keys * sizeof(uint64_t));
+    if (element_hashes == NULL) return SET_MALLOC_ERROR;
+    set->element_hashes = element_hashes;
+    set->number_elements = num_keys;
+    return SET_TRUE;
 }
 
-static void __relayout_nodes(PointSet *set, uint64_t start, short end_on_null)
+/*
+   Rehash into number_slots slots (the current count or more) in place:
+   grow the arrays, drop the tombstones, flag every full slot as displaced,
+   then move each displaced key to the first free slot of its new probe
+   sequence. A move that lands on another displaced slot swaps with it and
+   carries that key on, so every step settles one key and no second table
+   is needed.
+ */
+static int __rehash(PointSet *set, uint64_t number_slots)
 {
-    uint64_t index = 0;
-    for (uint64_t i = start; i < set->number_nodes; ++i)
+    uint64_t old_num = set->number_slots;
+    if (number_slots != old_num)
+	{
+        uint8_t *ctrl = (uint8_t *)realloc(set->ctrl, number_slots + GROUP_WIDTH);
+        if (ctrl == NULL) return SET_MALLOC_ERROR;
+        set->ctrl = ctrl;
+        point_set_slot *slots = (point_set_slot *)realloc(set->slots, number_slots * sizeof(point_set_slot));
+        if (slots == NULL) return SET_MALLOC_ERROR;
+        set->slots = slots;
+    }
+    uint8_t *ctrl = set->ctrl;
+    for (uint64_t i = 0; i < old_num; ++i) ctrl[i] = ctrl[i] < CTRL_EMPTY ? CTRL_DELETED : CTRL_EMPTY;
+    memset(ctrl + old_num, CTRL_EMPTY, number_slots - old_num);
+    memcpy(ctrl + number_slots, ctrl, GROUP_WIDTH);
+    set->number_slots = number_slots;
+    set->deleted_slots = 0;
+
+    for (uint64_t i = 0; i < old_num; ++i)
 	{
-        if(set->nodes[i] != NULL)
+        if (ctrl[i] != CTRL_DELETED) continue;
+        point_set_slot moving = set->slots[i];
+        __set_ctrl(set, i, CTRL_EMPTY);
+        while (1)
 		{
-            __get_index(set, set->nodes[i]->_key, set->nodes[i]->_hash, &index);
-            if (i != index) // we are moving this node
-			{ 
-                __assign_node(set, set->nodes[i]->_key, set->nodes[i]->_hash, index);
-                __free_index(set, i);
-            }
+            // settled slots are full; the first free one is empty or displaced
+            uint64_t hash = set->element_hashes[moving._element];
+            uint64_t j = __find_free(set, hash);
+            uint8_t was = ctrl[j];
+            point_set_slot next = set->slots[j];
+            set->slots[j] = moving;
+            __set_ctrl(set, j, (uint8_t)(hash & 0x7F));
+            set->element_slots[moving._element] = j;
+            if (was == CTRL_EMPTY) break;
+            moving = next;
         }
-		else if (end_on_null == 0 && i != start) break;
     }
+    return SET_TRUE;
 }
 
+static bool __same_box(const PointBitset *b1, const PointBitset *b2)
+{
+    return lat_equal(&b1->min, &b2->min) && b1->nx == b2->nx && b1->ny == b2->ny && b1->nz == b2->nz;
+}
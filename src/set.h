@@ -23,9 +23,11 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdbool.h>
 #include <inttypes.h> /* uint64_t */
 #include "numerics.h" /* flt_to_bytes */
 #include "point3d.h"
+#include "lattice.h"
 #include "chain.h"
 
 /* https://gcc.gnu.org/onlinedocs/gcc/Alternate-Keywords.html#Alternate-Keywords */
@@ -33,25 +35,44 @@ extern "C" {
 #define __inline__ inline
 #endif
 
-// sets will, for this program, be coming from chains, so 
-// MAX_SET_STR_LEN == MAX_CHAIN_STR_LEN
-#define MAX_SET_STR_LEN 22400
-
 // debating whether to pass point3d key by value or the ptr by value
 typedef uint64_t (*set_hash_function) (const Point3D *key);
 
+/*
+   Swiss-table layout: slots hold their key inline, and a separate array of
+   one control byte per slot says whether the slot is empty, deleted, or full
+   and then holds 7 bits of the key's hash (the full hash is kept with the
+   dense elements below). Lookups scan the control bytes a group of 16 at a
+   time (one SSE2 compare where available) and only touch a slot, for a
+   single 96-bit key compare, when its 7 bits match.
+
+   Keys are stored with -0.0 coordinates turned into 0.0, so equal sites
+   always have equal bits; a custom hash function sees the stored form.
+*/
 typedef struct
 {
-	Point3D *_key;
-    uint64_t _hash;
-} PointSetNode, point_set_node;
+    Point3D _key;
+    uint32_t _element; /* position of the key in the set's elements array */
+} PointSetSlot, point_set_slot;
 
+/*
+   Besides the hash table, every set keeps its keys in a dense array
+   (elements[0 .. used_slots - 1], in no particular order) so that a uniform
+   random element can be drawn in O(1), and the bulk operations can visit
+   every key, without walking the buckets.
+*/
 typedef struct
 {
-    point_set_node **nodes;
-    uint64_t number_nodes;
-    uint64_t used_nodes;
+    uint8_t *ctrl; /* number_slots control bytes, then a copy of the first 16 */
+    point_set_slot *slots;
+    uint64_t number_slots; /* always a power of two, at least 16 */
+    uint64_t used_slots;
+    uint64_t deleted_slots; /* tombstones, cleared by the next rehash */
     set_hash_function hash_function;
+    Point3D *elements;
+    uint64_t *element_slots; /* index into slots of each element */
+    uint64_t *element_hashes; /* hash of each element */
+    uint64_t number_elements; /* capacity of the three dense arrays */
 } PointSet, point_set;
 
 /*  Initialize the set either with default parameters (hash function and space)
@@ -68,6 +89,15 @@ static __inline__ int set_init(PointSet *set)
     return set_init_alt(set, 1024, NULL);
 }
 
+/*  Make room for num_keys keys in all, so adding up to that many needs no
+    further allocation or rehash
+
+    Returns:
+        SET_TRUE on success
+        SET_MALLOC_ERROR if unable to grow the set
+*/
+int set_reserve(PointSet *set, uint64_t num_keys);
+
 /* Utility function to clear out the set */
 int set_clear(PointSet *set);
 
@@ -227,6 +257,7 @@ int print_set(PointSet *set);
 int chain_to_set(Point3D chain[], int N, PointSet *set);
 
 
+/* Return an element of the set drawn uniformly at random, in O(1) */
 Point3D set_rand_choice(PointSet *set, threefry2x32_ctr_t *ctr, threefry2x32_key_t *key);
 /*  Return an array of the elements in the set
     NOTE: Up to the caller to free the memory */
@@ -247,6 +278,97 @@ Point3D set_rand_choice(PointSet *set, threefry2x32_ctr_t *ctr, threefry2x32_key
 #define SET_EQUAL 0
 #define SET_UNEQUAL 2
 
+/*
+   A set of lattice sites inside a fixed box [min, max], one bit per site, x
+   fastest. When both operands of a set operation fit in the same box the
+   operation is a pass over whole words, and membership is one shift and
+   mask, with no hashing at all; for the few hundred sites around a chain end
+   that is a handful of words. Keys are taken to be lattice sites (rounded
+   with lat_from_pt).
+
+   The bitset operations return SET_FALSE, and leave res alone, if their
+   operands do not share a box.
+*/
+typedef struct
+{
+    LatticePoint min;
+    int32_t nx, ny, nz; /* sites along each axis */
+    uint64_t number_words;
+    uint64_t *words;
+} PointBitset, point_bitset;
+
+/*  Initialize an empty bitset over the box [min, max]
+
+    Returns:
+        SET_TRUE on success
+        SET_MALLOC_ERROR if the words could not be allocated
+*/
+int set_bitset_init(PointBitset *bits, const LatticePoint *min, const LatticePoint *max);
+
+void set_bitset_destroy(PointBitset *bits);
+
+void set_bitset_clear(PointBitset *bits);
+
+/* Bit of key in bits, or false if key is outside the box */
+static __inline__ bool set_bitset_index(const PointBitset *bits, const Point3D *key, uint64_t *index)
+{
+    LatticePoint p = lat_from_pt(key);
+    uint32_t x = (uint32_t)(p.x - bits->min.x);
+    uint32_t y = (uint32_t)(p.y - bits->min.y);
+    uint32_t z = (uint32_t)(p.z - bits->min.z);
+    if (x >= (uint32_t)bits->nx || y >= (uint32_t)bits->ny || z >= (uint32_t)bits->nz) return false;
+    *index = ((uint64_t)z * bits->ny + y) * bits->nx + x;
+    return true;
+}
+
+/*  Returns:
+        SET_TRUE if added or already present
+        SET_FALSE if key is outside the box
+*/
+static __inline__ int set_bitset_add(PointBitset *bits, const Point3D *key)
+{
+    uint64_t index;
+    if (!set_bitset_index(bits, key, &index)) return SET_FALSE;
+    bits->words[index >> 6] |= UINT64_C(1) << (index & 63);
+    return SET_TRUE;
+}
+
+/* SET_TRUE if key is in bits, SET_FALSE if not (or outside the box) */
+static __inline__ int set_bitset_contains(const PointBitset *bits, const Point3D *key)
+{
+    uint64_t index;
+    if (!set_bitset_index(bits, key, &index)) return SET_FALSE;
+    return (bits->words[index >> 6] >> (index & 63)) & 1 ? SET_TRUE : SET_FALSE;
+}
+
+/* Return the number of sites in the bitset */
+uint64_t set_bitset_length(const PointBitset *bits);
+
+/*  Replace the contents of bits with the keys of set
+
+    Returns:
+        SET_TRUE on success
+        SET_FALSE if some key of set is outside the box; bits then holds
+            the keys that are inside
+*/
+int set_to_bitset(PointBitset *bits, PointSet *set);
+
+/*  Add every site of bits to set
+
+    Returns:
+        SET_TRUE on success
+        SET_MALLOC_ERROR if unable to grow the set
+*/
+int set_from_bitset(PointSet *set, const PointBitset *bits);
+
+/* The bitset counterparts of set_union, set_intersection, set_difference,
+   set_symmetric_difference and set_is_subset */
+int set_bitset_union(PointBitset *res, const PointBitset *b1, const PointBitset *b2);
+int set_bitset_intersection(PointBitset *res, const PointBitset *b1, const PointBitset *b2);
+int set_bitset_difference(PointBitset *res, const PointBitset *b1, const PointBitset *b2);
+int set_bitset_symmetric_difference(PointBitset *res, const PointBitset *b1, const PointBitset *b2);
+int set_bitset_is_subset(const PointBitset *test, const PointBitset *against);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,150 @@
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Small SIMD layer over GCC vector extensions.
+ *
+ * A vdouble holds SIMD_WIDTH doubles: 4 when building for AVX, 2 otherwise.
+ * Arithmetic and comparisons use the ordinary operators and compile to AVX,
+ * SSE2 or scalar code depending on the target flags. Only what the operators
+ * cannot express (sqrt, loads, blends, atan2) lives here. Comparisons give a
+ * vmask whose lanes are all ones (true) or all zeros (false).
+ */
+
+#if defined(__AVX__)
+#define SIMD_WIDTH 4
+#else
+#define SIMD_WIDTH 2
+#endif
+
+typedef double vdouble __attribute__((vector_size(SIMD_WIDTH * sizeof(double))));
+typedef int64_t vmask __attribute__((vector_size(SIMD_WIDTH * sizeof(int64_t))));
+
+#define SIMD_PI 3.14159265358979323846
+#define SIMD_PI_2 1.57079632679489661923
+#define SIMD_PI_4 0.78539816339744830962
+#define SIMD_TAN_PI_8 0.41421356237309504880
+
+/* Unaligned load and store */
+static inline vdouble vd_load(const double *p)
+{
+	vdouble v;
+	memcpy(&v, p, sizeof(vdouble));
+	return v;
+}
+
+static inline void vd_store(double *p, vdouble v)
+{
+	memcpy(p, &v, sizeof(vdouble));
+}
+
+static inline vdouble vd_set1(double x)
+{
+	vdouble v;
+	for (int k = 0; k < SIMD_WIDTH; k++) v[k] = x;
+	return v;
+}
+
+/* Lane-wise m ? a : b */
+static inline vdouble vd_select(vmask m, vdouble a, vdouble b)
+{
+	return (vdouble)((m & (vmask)a) | (~m & (vmask)b));
+}
+
+static inline vdouble vd_abs(vdouble a)
+{
+	return (vdouble)((vmask)a & ~(vmask)vd_set1(-0.0));
+}
+
+/* a with the sign bit of s */
+static inline vdouble vd_copysign(vdouble a, vdouble s)
+{
+	vmask sign = (vmask)vd_set1(-0.0);
+	return (vdouble)(((vmask)a & ~sign) | ((vmask)s & sign));
+}
+
+static inline vdouble vd_sqrt(vdouble a)
+{
+#if defined(__AVX__)
+	return (vdouble)_mm256_sqrt_pd((__m256d)a);
+#elif defined(__SSE2__)
+	return (vdouble)_mm_sqrt_pd((__m128d)a);
+#else
+	for (int k = 0; k < SIMD_WIDTH; k++) a[k] = __builtin_sqrt(a[k]);
+	return a;
+#endif
+}
+
+/*
+ * Four floats, a width every SSE/NEON target has, for packed float data such
+ * as runs of Point3D coordinates. The bits of a vfloat4 can be handled as a
+ * vint4, and __builtin_shuffle(a, b, (vint4){...}) picks lanes of a then b.
+ */
+typedef float vfloat4 __attribute__((vector_size(4 * sizeof(float))));
+typedef int32_t vint4 __attribute__((vector_size(4 * sizeof(int32_t))));
+
+static inline vfloat4 vf4_load(const float *p)
+{
+	vfloat4 v;
+	memcpy(&v, p, sizeof(vfloat4));
+	return v;
+}
+
+static inline void vf4_store(float *p, vfloat4 v)
+{
+	memcpy(p, &v, sizeof(vfloat4));
+}
+
+static inline double vd_sum(vdouble a)
+{
+	double sum = 0.0;
+	for (int k = 0; k < SIMD_WIDTH; k++) sum += a[k];
+	return sum;
+}
+
+/*
+ * Lane-wise atan2(y, x), good to a couple of ulp, with atan2(0, 0) = 0.
+ *
+ * The ratio is folded into [-tan(pi/8), tan(pi/8)] and fed to the Cephes
+ * rational approximation of atan; the quadrant is restored from the signs of
+ * x and y.
+ */
+static inline vdouble vd_atan2(vdouble y, vdouble x)
+{
+	vdouble ax = vd_abs(x), ay = vd_abs(y);
+	vmask swap = (vmask)(ay > ax);
+	vdouble num = vd_select(swap, ax, ay);
+	vdouble den = vd_select(swap, ay, ax);
+	den = vd_select((vmask)(den == 0.0), vd_set1(1.0), den);
+
+	// fold before dividing, so one division gives the reduced argument
+	vmask fold = (vmask)(num > SIMD_TAN_PI_8 * den);
+	vdouble t = vd_select(fold, num - den, num) / vd_select(fold, num + den, den);
+
+	vdouble z = t * t;
+	vdouble p = (((-8.750608600031904122785e-1 * z
+		- 1.615753718733365076637e1) * z
+		- 7.500855792314704667340e1) * z
+		- 1.228866684490136173410e2) * z
+		- 6.485021904942025371773e1;
+	vdouble q = ((((z
+		+ 2.485846490142306297962e1) * z
+		+ 1.650270098316988542046e2) * z
+		+ 4.328810604912902668951e2) * z
+		+ 4.853903996359136964868e2) * z
+		+ 1.945506571482613964425e2;
+	vdouble r = t + t * z * p / q;
+
+	r = vd_select(fold, r + SIMD_PI_4, r);
+	r = vd_select(swap, SIMD_PI_2 - r, r);
+	r = vd_select((vmask)(x < 0.0), SIMD_PI - r, r);
+	return vd_copysign(r, y);
+}
+
+#endif /* SIMD_H_ */
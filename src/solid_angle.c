@@ -0,0 +1,187 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "solid_angle.h"
+
+/* PRIVATE FUNCTIONS */
+static void __block(const SegArray *a, int i0, int i1, const SegArray *b,
+	int j0, int j1, bool self, double *work, double *sum, double *abs_sum);
+static void __fill_row(const SegArray *b, int j0, int n, const SegArray *a, int i,
+	double *row);
+static inline vdouble __omega(vdouble x13, vdouble y13, vdouble z13, vdouble n13,
+	vdouble x14, vdouble y14, vdouble z14, vdouble n14,
+	vdouble x23, vdouble y23, vdouble z23, vdouble n23,
+	vdouble x24, vdouble y24, vdouble z24, vdouble n24);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int seg_array_init(SegArray *segs, const Point3D pts[], int N)
+{
+	// the padding lets SIMD loads run past the last vertex
+	size_t len = (size_t)N + 1 + SIMD_WIDTH;
+	segs->n = N;
+	segs->x = (double *)malloc(3 * len * sizeof(double));
+	if (segs->x == NULL) return SOLID_ANGLE_MALLOC_ERROR;
+	segs->y = segs->x + len;
+	segs->z = segs->y + len;
+	for (size_t v = 0; v < len; v++)
+	{
+		const Point3D *p = &pts[v < (size_t)N ? v : 0];
+		segs->x[v] = p->x;
+		segs->y[v] = p->y;
+		segs->z[v] = p->z;
+	}
+	return SOLID_ANGLE_TRUE;
+}
+
+void seg_array_destroy(SegArray *segs)
+{
+	free(segs->x);
+	segs->x = segs->y = segs->z = NULL;
+	segs->n = 0;
+}
+
+double solid_angle_block(const SegArray *a, int i0, int i1,
+	const SegArray *b, int j0, int j1, double *work)
+{
+	double sum, abs_sum;
+	__block(a, i0, i1, b, j0, j1, false, work, &sum, &abs_sum);
+	return sum;
+}
+
+void solid_angle_block_self(const SegArray *segs, int i0, int i1, int j0, int j1,
+	double *work, double *sum, double *abs_sum)
+{
+	__block(segs, i0, i1, segs, j0, j1, true, work, sum, abs_sum);
+}
+
+double solid_angle_pair(const Point3D *p1, const Point3D *p2,
+	const Point3D *p3, const Point3D *p4)
+{
+	double r[4][3] = {
+		{p3->x - p1->x, p3->y - p1->y, p3->z - p1->z},
+		{p4->x - p1->x, p4->y - p1->y, p4->z - p1->z},
+		{p3->x - p2->x, p3->y - p2->y, p3->z - p2->z},
+		{p4->x - p2->x, p4->y - p2->y, p4->z - p2->z}
+	};
+	vdouble c[4][4];
+	for (int m = 0; m < 4; m++)
+	{
+		double norm = sqrt(r[m][0] * r[m][0] + r[m][1] * r[m][1] + r[m][2] * r[m][2]);
+		c[m][0] = vd_set1(r[m][0]);
+		c[m][1] = vd_set1(r[m][1]);
+		c[m][2] = vd_set1(r[m][2]);
+		c[m][3] = vd_set1(norm);
+	}
+	vdouble omega = __omega(c[0][0], c[0][1], c[0][2], c[0][3],
+		c[1][0], c[1][1], c[1][2], c[1][3],
+		c[2][0], c[2][1], c[2][2], c[2][3],
+		c[3][0], c[3][1], c[3][2], c[3][3]);
+	return omega[0];
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+/*
+ * Sum omega and |omega| over i0 <= i < i1, j0 <= j < j1. With self set, a and
+ * b are one chain and only pairs with j > i whose segments share no vertex
+ * count; adjacent segments are coplanar and contribute nothing anyway.
+ */
+static void __block(const SegArray *a, int i0, int i1, const SegArray *b,
+	int j0, int j1, bool self, double *work, double *sum, double *abs_sum)
+{
+	*sum = *abs_sum = 0.0;
+	int n = j1 - j0;
+	if (i0 >= i1 || n <= 0) return;
+
+	// a row holds x, y, z and |.| of b_j - a_i for the n + 1 vertices of the
+	// column range; rows i and i + 1 give r13, r14 and r23, r24 of every pair
+	size_t stride = (size_t)n + SIMD_WIDTH;
+	double *row1 = work, *row2 = work + 4 * stride;
+	__fill_row(b, j0, n, a, i0, row1);
+
+	vdouble lane;
+	for (int k = 0; k < SIMD_WIDTH; k++) lane[k] = k;
+	vdouble zero = vd_set1(0.0);
+	vdouble total = zero, abs_total = zero;
+	for (int i = i0; i < i1; i++)
+	{
+		__fill_row(b, j0, n, a, i + 1, row2);
+		const double *x1 = row1, *y1 = row1 + stride, *z1 = row1 + 2 * stride, *n1 = row1 + 3 * stride;
+		const double *x2 = row2, *y2 = row2 + stride, *z2 = row2 + 2 * stride, *n2 = row2 + 3 * stride;
+		// columns before first_j are adjacent to or below the diagonal
+		int first_j = self && i + 2 > j0 ? i + 2 : j0;
+		int last_j = self && i == 0 && j1 == b->n ? j1 - 1 : j1;
+		for (int v = first_j - j0 - (first_j - j0) % SIMD_WIDTH; v < n; v += SIMD_WIDTH)
+		{
+			vdouble omega = __omega(
+				vd_load(x1 + v), vd_load(y1 + v), vd_load(z1 + v), vd_load(n1 + v),
+				vd_load(x1 + v + 1), vd_load(y1 + v + 1), vd_load(z1 + v + 1), vd_load(n1 + v + 1),
+				vd_load(x2 + v), vd_load(y2 + v), vd_load(z2 + v), vd_load(n2 + v),
+				vd_load(x2 + v + 1), vd_load(y2 + v + 1), vd_load(z2 + v + 1), vd_load(n2 + v + 1));
+			// drop lanes outside [first_j, last_j), including the padding
+			vdouble j = lane + (double)(j0 + v);
+			omega = vd_select((vmask)(j >= (double)first_j) & (vmask)(j < (double)last_j),
+				omega, zero);
+			total += omega;
+			abs_total += vd_abs(omega);
+		}
+		double *tmp = row1;
+		row1 = row2;
+		row2 = tmp;
+	}
+	*sum = vd_sum(total);
+	*abs_sum = vd_sum(abs_total);
+}
+
+/* b_j - a_i and its length for vertices j0 .. j0 + n, rounded up to SIMD_WIDTH */
+static void __fill_row(const SegArray *b, int j0, int n, const SegArray *a, int i,
+	double *row)
+{
+	size_t stride = (size_t)n + SIMD_WIDTH;
+	double *rx = row, *ry = row + stride, *rz = row + 2 * stride, *rn = row + 3 * stride;
+	vdouble px = vd_set1(a->x[i]), py = vd_set1(a->y[i]), pz = vd_set1(a->z[i]);
+	for (int v = 0; v <= n; v += SIMD_WIDTH)
+	{
+		vdouble dx = vd_load(b->x + j0 + v) - px;
+		vdouble dy = vd_load(b->y + j0 + v) - py;
+		vdouble dz = vd_load(b->z + j0 + v) - pz;
+		vd_store(rx + v, dx);
+		vd_store(ry + v, dy);
+		vd_store(rz + v, dz);
+		vd_store(rn + v, vd_sqrt(dx * dx + dy * dy + dz * dz));
+	}
+}
+
+static inline vdouble __omega(vdouble x13, vdouble y13, vdouble z13, vdouble n13,
+	vdouble x14, vdouble y14, vdouble z14, vdouble n14,
+	vdouble x23, vdouble y23, vdouble z23, vdouble n23,
+	vdouble x24, vdouble y24, vdouble z24, vdouble n24)
+{
+	vdouble d13_14 = x13 * x14 + y13 * y14 + z13 * z14;
+	vdouble d13_24 = x13 * x24 + y13 * y24 + z13 * z24;
+	vdouble d13_23 = x13 * x23 + y13 * y23 + z13 * z23;
+	vdouble d14_24 = x14 * x24 + y14 * y24 + z14 * z24;
+	vdouble d24_23 = x24 * x23 + y24 * y23 + z24 * z23;
+
+	// triangle (r13, r14, r24)
+	vdouble cx = y14 * z24 - z14 * y24;
+	vdouble cy = z14 * x24 - x14 * z24;
+	vdouble cz = x14 * y24 - y14 * x24;
+	vdouble t1 = x13 * cx + y13 * cy + z13 * cz;
+	vdouble s1 = n13 * n14 * n24 + d13_14 * n24 + d13_24 * n14 + d14_24 * n13;
+
+	// triangle (r13, r24, r23)
+	cx = y24 * z23 - z24 * y23;
+	cy = z24 * x23 - x24 * z23;
+	cz = x24 * y23 - y24 * x23;
+	vdouble t2 = x13 * cx + y13 * cy + z13 * cz;
+	vdouble s2 = n13 * n24 * n23 + d13_24 * n23 + d13_23 * n24 + d24_23 * n13;
+
+	// the triangles' orientation is opposite to the Gauss integral's
+	return -2.0 * vd_atan2(s1 * t2 + t1 * s2, s1 * s2 - t1 * t2);
+}
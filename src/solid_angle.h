@@ -0,0 +1,66 @@
+#ifndef SOLID_ANGLE_H_
+#define SOLID_ANGLE_H_
+
+#include <stddef.h>
+#include "point3d.h"
+#include "simd.h"
+
+#define SOLID_ANGLE_TRUE 0
+#define SOLID_ANGLE_MALLOC_ERROR -2
+
+/*
+ * Segment-pair solid angles for Gauss-integral quantities on closed chains.
+ *
+ * For segments p1 -> p2 and p3 -> p4, omega is the signed solid angle the
+ * quadrilateral r13, r14, r24, r23 (rij = pj - pi) subtends at the origin,
+ * which is the exact Gauss double integral of the pair (Klenin & Langowski,
+ * Biopolymers 54, 2000). Summed over all pairs of two closed chains it is
+ * 4 pi times their linking number.
+ *
+ * Instead of Klenin & Langowski's four arcsines, the quadrilateral is split
+ * into the triangles (r13, r14, r24) and (r13, r24, r23), each given by
+ * Van Oosterom & Strackee's tan(omega / 2) = y / x, and the two half angles
+ * are added as complex arguments, leaving one atan2 per pair:
+ *
+ *     omega = 2 atan2(x1 y2 + y1 x2, x1 x2 - y1 y2)
+ *
+ * which is exact because |omega| <= 2 pi.
+ */
+
+/* A closed chain as structure-of-arrays coordinates, ready for SIMD loads */
+typedef struct
+{
+	double *x, *y, *z; /* n + 1 vertices (vertex n repeats vertex 0), padded */
+	int n;             /* segments, equal to the number of monomers */
+} SegArray, seg_array;
+
+int seg_array_init(SegArray *segs, const Point3D pts[], int N);
+
+void seg_array_destroy(SegArray *segs);
+
+/* Scratch doubles solid_angle_block needs for a column range of n segments */
+static inline size_t solid_angle_work_len(int n)
+{
+	return 8 * ((size_t)n + SIMD_WIDTH);
+}
+
+/*
+ * Sum of omega over segments i0 <= i < i1 of a against j0 <= j < j1 of b.
+ * work must hold solid_angle_work_len(j1 - j0) doubles.
+ */
+double solid_angle_block(const SegArray *a, int i0, int i1,
+	const SegArray *b, int j0, int j1, double *work);
+
+/*
+ * Sums of omega and |omega| over pairs i < j of one closed chain's segments
+ * with i0 <= i < i1, j0 <= j < j1, skipping pairs that share a vertex.
+ * work is as for solid_angle_block.
+ */
+void solid_angle_block_self(const SegArray *segs, int i0, int i1, int j0, int j1,
+	double *work, double *sum, double *abs_sum);
+
+/* omega of the single segment pair p1 -> p2, p3 -> p4, without SIMD */
+double solid_angle_pair(const Point3D *p1, const Point3D *p2,
+	const Point3D *p3, const Point3D *p4);
+
+#endif /* SOLID_ANGLE_H_ */
@@ -0,0 +1,651 @@
+#define _POSIX_C_SOURCE 200809L /* fsync, fileno */
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "study.h"
+#include "ensemble.h"
+#include "linking.h"
+#include "rng.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define CHECKPOINT_MAGIC "TLSTUDY\0"
+#define CHECKPOINT_VERSION 2
+
+/*
+ * Checkpoint files, in native byte order: this header, the separations as
+ * doubles, the int64 counts of every separation's histogram, then a bitmap
+ * of the pairs analysed (bit k % 8 of byte k / 8 for pair k).
+ */
+struct study_checkpoint
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t N;
+	uint32_t num_pairs;
+	uint32_t seed;
+	uint32_t num_separations;
+	uint32_t pool_rings;      /* 0 without a pool */
+	int64_t pairs;            /* hist->pairs */
+	int64_t analysed;         /* bits set in the bitmap */
+	uint64_t pool_hash;       /* of every pool ring's sites in order; 0 without a pool */
+};
+
+/* a generated pair waiting in, or moving through, the pipeline */
+struct study_slot
+{
+	Point3D *a, *b; /* N monomers each */
+	int pair;
+};
+
+/* state shared by every worker of one study_run call */
+struct study_job
+{
+	const StudyParams *params;
+	StudyHist *hist;
+	Point3D *dirs;
+	int dirs_len;
+	int dim;
+
+	struct study_slot *slots;
+	int queue_len;
+	int *ready;         /* FIFO of generated slots */
+	int ready_head, num_ready;
+	int *free_slots;    /* stack of empty slots */
+	int num_free;
+	int next_pair;      /* next pair to generate */
+	int done_pairs;     /* pairs analysed, or given up on after an error */
+	long since_flush;
+	unsigned char *analysed; /* bitmap of the pairs in hist */
+	time_t last_checkpoint;
+	int checkpoint_status;
+	uint64_t pool_hash;      /* __pool_hash of params->pool, for the checkpoint */
+	int64_t *ckpt_counts;    /* snapshot of hist->counts a checkpoint is written from */
+	unsigned char *ckpt_analysed; /* and of analysed */
+	bool checkpointing;      /* a worker is writing the snapshot */
+	StudyHist flush_hist;    /* snapshot of hist the flush callback is handed */
+	bool flushing;           /* a worker is running the flush callback */
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	int status;
+};
+
+/* PRIVATE FUNCTIONS */
+static void *__worker(void *arg);
+static int __analyse(struct study_job *job, const struct study_slot *slot,
+	long counts[]);
+static void __bcc_round(const double v[3], double out[3]);
+static void __skip_analysed(struct study_job *job);
+static void __flush(struct study_job *job);
+static uint64_t __pool_hash(const ChainPool *pool);
+static void __checkpoint(struct study_job *job);
+static int __checkpoint_write(const struct study_job *job, const struct study_checkpoint *ckpt);
+static int __checkpoint_read(struct study_job *job);
+static void __checkpoint_fill(const struct study_job *job, struct study_checkpoint *ckpt);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int study_hist_init(StudyHist *hist, const double separations[], int num_separations)
+{
+	hist->num_separations = num_separations;
+	hist->pairs = 0;
+	hist->separations = (double *)malloc(num_separations * sizeof(double));
+	hist->counts = (long *)calloc((size_t)num_separations * STUDY_NUM_BINS, sizeof(long));
+	if (!hist->separations || !hist->counts)
+	{
+		study_hist_destroy(hist);
+		return STUDY_MALLOC_ERROR;
+	}
+	memcpy(hist->separations, separations, num_separations * sizeof(double));
+	return STUDY_TRUE;
+}
+
+void study_hist_destroy(StudyHist *hist)
+{
+	free(hist->separations);
+	free(hist->counts);
+	hist->separations = NULL;
+	hist->counts = NULL;
+	hist->num_separations = 0;
+}
+
+int study_run(const StudyParams *params, StudyHist *hist,
+	Point3D dirs[], int dirs_len, int dim)
+{
+	if (params->N < 4 || params->N % 2 != 0 || params->num_pairs < 0) return STUDY_INVALID_PARAMS;
+	if (params->pool && (params->pool->N != params->N || params->pool->num_rings < 1))
+	{
+		return STUDY_INVALID_PARAMS;
+	}
+
+	int num_threads = params->num_threads > 0 ? params->num_threads : 1;
+	if (num_threads > params->num_pairs) num_threads = params->num_pairs > 0 ? params->num_pairs : 1;
+	int queue_len = params->queue_len > 0 ? params->queue_len : 2 * num_threads;
+	int N = params->N;
+
+	struct study_job job = {
+		.params      = params,
+		.hist        = hist,
+		.dirs        = dirs,
+		.dirs_len    = dirs_len,
+		.dim         = dim,
+		.queue_len   = queue_len,
+		.ready_head  = 0,
+		.num_ready   = 0,
+		.num_free    = queue_len,
+		.next_pair   = 0,
+		.done_pairs  = 0,
+		.since_flush = 0,
+		.last_checkpoint = time(NULL),
+		.checkpoint_status = STUDY_TRUE,
+		.pool_hash   = params->checkpoint && params->pool ? __pool_hash(params->pool) : 0,
+		.checkpointing = false,
+		.flushing    = false,
+		.status      = STUDY_TRUE
+	};
+	job.slots = (struct study_slot *)calloc(queue_len, sizeof(struct study_slot));
+	job.ready = (int *)malloc(queue_len * sizeof(int));
+	job.free_slots = (int *)malloc(queue_len * sizeof(int));
+	job.analysed = (unsigned char *)calloc((size_t)params->num_pairs / 8 + 1, 1);
+	Point3D *pool = (Point3D *)malloc((size_t)queue_len * 2 * N * sizeof(Point3D));
+	job.ckpt_counts = NULL;
+	job.ckpt_analysed = NULL;
+	job.flush_hist.num_separations = hist->num_separations;
+	job.flush_hist.separations = hist->separations;
+	job.flush_hist.counts = NULL;
+	if (params->flush)
+	{
+		job.flush_hist.counts = (long *)malloc((size_t)hist->num_separations * STUDY_NUM_BINS * sizeof(long));
+	}
+	if (params->checkpoint)
+	{
+		job.ckpt_counts = (int64_t *)malloc((size_t)hist->num_separations * STUDY_NUM_BINS * sizeof(int64_t));
+		job.ckpt_analysed = (unsigned char *)malloc((size_t)params->num_pairs / 8 + 1);
+	}
+	int status = STUDY_TRUE;
+	if (!job.slots || !job.ready || !job.free_slots || !job.analysed || !pool
+		|| (params->flush && !job.flush_hist.counts)
+		|| (params->checkpoint && (!job.ckpt_counts || !job.ckpt_analysed)))
+	{
+		status = STUDY_MALLOC_ERROR;
+	}
+	else if (params->checkpoint)
+	{
+		status = __checkpoint_read(&job);
+	}
+	if (status != STUDY_TRUE)
+	{
+		free(job.slots);
+		free(job.ready);
+		free(job.free_slots);
+		free(job.analysed);
+		free(job.ckpt_counts);
+		free(job.ckpt_analysed);
+		free(job.flush_hist.counts);
+		free(pool);
+		return status;
+	}
+	__skip_analysed(&job);
+	for (int s = 0; s < queue_len; s++)
+	{
+		job.slots[s].a = pool + (size_t)2 * s * N;
+		job.slots[s].b = job.slots[s].a + N;
+		job.free_slots[s] = s;
+	}
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.changed, NULL);
+
+	pthread_t *threads = NULL;
+	if (num_threads > 1) threads = (pthread_t *)malloc((num_threads - 1) * sizeof(pthread_t));
+	int started = 0;
+	for (; threads && started < num_threads - 1; started++)
+	{
+		// work is claimed dynamically, so however many threads start, the
+		// ones running (this one included) cover every pair
+		if (pthread_create(&threads[started], NULL, __worker, &job) != 0) break;
+	}
+	__worker(&job);
+	for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+	free(threads);
+
+	// every worker has returned, so hist itself can be handed over
+	if (params->flush) params->flush(hist, params->flush_ctx);
+	if (params->checkpoint && job.status == STUDY_TRUE)
+	{
+		pthread_mutex_lock(&job.lock);
+		__checkpoint(&job);
+		pthread_mutex_unlock(&job.lock);
+	}
+	pthread_cond_destroy(&job.changed);
+	pthread_mutex_destroy(&job.lock);
+	free(job.slots);
+	free(job.ready);
+	free(job.free_slots);
+	free(job.analysed);
+	free(job.ckpt_counts);
+	free(job.ckpt_analysed);
+	free(job.flush_hist.counts);
+	free(pool);
+	return job.status != STUDY_TRUE ? job.status : job.checkpoint_status;
+}
+
+void study_hist_write(const StudyHist *hist, FILE *out)
+{
+	fprintf(out, "# pairs %ld\n", hist->pairs);
+	fprintf(out, "# separation\tpairs\tp_link");
+	for (int lk = -STUDY_MAX_LK; lk <= STUDY_MAX_LK; lk++) fprintf(out, "\tlk%+d", lk);
+	fprintf(out, "\n");
+	for (int s = 0; s < hist->num_separations; s++)
+	{
+		const long *counts = hist->counts + (size_t)s * STUDY_NUM_BINS;
+		long unlinked = counts[STUDY_MAX_LK];
+		double p_link = hist->pairs > 0 ? (double)(hist->pairs - unlinked) / hist->pairs : 0.0;
+		fprintf(out, "%g\t%ld\t%.6f", hist->separations[s], hist->pairs, p_link);
+		for (int bin = 0; bin < STUDY_NUM_BINS; bin++) fprintf(out, "\t%ld", counts[bin]);
+		fprintf(out, "\n");
+	}
+}
+
+void study_flush_fprint(const StudyHist *hist, void *ctx)
+{
+	FILE *out = (FILE *)ctx;
+	study_hist_write(hist, out);
+	fprintf(out, "\n");
+	fflush(out);
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static void *__worker(void *arg)
+{
+	struct study_job *job = (struct study_job *)arg;
+	const StudyParams *params = job->params;
+	int N = params->N;
+	int num_seps = params->num_separations;
+
+	// per-worker buffers: the occupancy bitmap for generating and one pair's
+	// histogram rows for analysing
+	OccBitmap occ;
+	bool have_occ = occ_bitmap_init(&occ, N) == OCC_TRUE;
+	long *counts = (long *)malloc((size_t)num_seps * STUDY_NUM_BINS * sizeof(long));
+
+	pthread_mutex_lock(&job->lock);
+	if (!have_occ || !counts) job->status = STUDY_MALLOC_ERROR;
+	while (job->done_pairs < params->num_pairs)
+	{
+		if (job->status != STUDY_TRUE)
+		{
+			// stop handing out work; the pairs never generated count as done
+			for (; job->next_pair < params->num_pairs; job->next_pair++)
+			{
+				if (!(job->analysed[job->next_pair / 8] >> (job->next_pair % 8) & 1)) job->done_pairs++;
+			}
+			pthread_cond_broadcast(&job->changed);
+			break;
+		}
+		if (job->num_ready > 0)
+		{
+			int s = job->ready[job->ready_head];
+			job->ready_head = (job->ready_head + 1) % job->queue_len;
+			job->num_ready--;
+			pthread_mutex_unlock(&job->lock);
+
+			int status = __analyse(job, &job->slots[s], counts);
+
+			pthread_mutex_lock(&job->lock);
+			job->free_slots[job->num_free++] = s;
+			job->done_pairs++;
+			if (status != STUDY_TRUE)
+			{
+				job->status = status;
+				continue;
+			}
+			StudyHist *hist = job->hist;
+			for (size_t i = 0; i < (size_t)num_seps * STUDY_NUM_BINS; i++) hist->counts[i] += counts[i];
+			hist->pairs++;
+			job->analysed[job->slots[s].pair / 8] |= 1 << (job->slots[s].pair % 8);
+			job->since_flush++;
+			// a flush due while another is running waits for the next pair
+			bool requested = params->flush_request && *params->flush_request;
+			bool flushed = false;
+			if (params->flush && !job->flushing && (requested
+				|| (params->flush_every > 0 && job->since_flush >= params->flush_every)))
+			{
+				if (requested) *params->flush_request = 0;
+				job->since_flush = 0;
+				__flush(job);
+				flushed = true;
+			}
+			// the snapshot is taken under the lock, so the file matches hist,
+			// and written outside it, so the fsync stalls no other worker
+			if (params->checkpoint && (flushed || (params->checkpoint_secs > 0
+				&& time(NULL) - job->last_checkpoint >= params->checkpoint_secs)))
+			{
+				__checkpoint(job);
+			}
+			pthread_cond_broadcast(&job->changed);
+		}
+		else if (job->next_pair < params->num_pairs && job->num_free > 0)
+		{
+			int s = job->free_slots[--job->num_free];
+			int pair = job->next_pair++;
+			__skip_analysed(job);
+			pthread_mutex_unlock(&job->lock);
+
+			struct study_slot *slot = &job->slots[s];
+			slot->pair = pair;
+			threefry2x32_ctr_t ctr;
+			threefry2x32_key_t key;
+			ensemble_stream(params->seed, 2 * pair, &ctr, &key);
+			bool generated = true;
+			if (params->pool)
+			{
+				pool_draw(params->pool, slot->a, &ctr, &key);
+				pool_draw(params->pool, slot->b, &ctr, &key);
+			}
+			else
+			{
+				generated = sample_closed_chain(slot->a, N, job->dirs, job->dirs_len,
+					job->dim, &occ, &ctr, &key) != OCC_MALLOC_ERROR;
+				ensemble_stream(params->seed, 2 * pair + 1, &ctr, &key);
+				generated = generated && sample_closed_chain(slot->b, N, job->dirs,
+					job->dirs_len, job->dim, &occ, &ctr, &key) != OCC_MALLOC_ERROR;
+			}
+
+			pthread_mutex_lock(&job->lock);
+			if (!generated)
+			{
+				job->free_slots[job->num_free++] = s;
+				job->done_pairs++;
+				job->status = STUDY_MALLOC_ERROR;
+				continue;
+			}
+			int tail = (job->ready_head + job->num_ready) % job->queue_len;
+			job->ready[tail] = s;
+			job->num_ready++;
+			pthread_cond_broadcast(&job->changed);
+		}
+		else
+		{
+			pthread_cond_wait(&job->changed, &job->lock);
+		}
+	}
+	pthread_mutex_unlock(&job->lock);
+
+	if (have_occ) occ_bitmap_destroy(&occ);
+	free(counts);
+	return NULL;
+}
+
+/* Histogram one pair at every separation into counts, which is overwritten */
+static int __analyse(struct study_job *job, const struct study_slot *slot,
+	long counts[])
+{
+	const StudyParams *params = job->params;
+	int N = params->N;
+	int num_seps = params->num_separations;
+	memset(counts, 0, (size_t)num_seps * STUDY_NUM_BINS * sizeof(long));
+
+	double com_a[3], com_b[3];
+	chain_centre(slot->a, N, com_a);
+	chain_centre(slot->b, N, com_b);
+
+	// directions come from the pair's own stream, clear of the counters
+	// generating its rings used
+	threefry2x32_ctr_t ctr;
+	threefry2x32_key_t key;
+	ensemble_stream(params->seed, 2 * slot->pair, &ctr, &key);
+	ctr.v[1] = ENS_AUX_STREAM;
+	RngStream rng;
+	rng_init(&rng, ctr, key);
+
+	for (int s = 0; s < num_seps; s++)
+	{
+		double cos_theta = rng_flt(&rng, -1.0f, 1.0f);
+		double phi = rng_flt(&rng, 0.0f, (float)(2.0 * M_PI));
+		double sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+		double d = params->separations[s];
+		double target[3] = {
+			com_a[0] - com_b[0] + d * sin_theta * cos(phi),
+			com_a[1] - com_b[1] + d * sin_theta * sin(phi),
+			com_a[2] - com_b[2] + d * cos_theta
+		};
+		// the nearest lattice translation, then off the lattice so the
+		// rings cannot meet
+		double shift[3];
+		__bcc_round(target, shift);
+		shift[0] += 0.5;
+		shift[1] += 0.25;
+
+		int lk;
+		int status = link_crossings_shifted(slot->a, N, slot->b, N, shift, &lk);
+		if (status == LINK_MALLOC_ERROR) return STUDY_MALLOC_ERROR;
+		if (status != LINK_TRUE) return STUDY_LINK_ERROR;
+		if (lk < -STUDY_MAX_LK) lk = -STUDY_MAX_LK;
+		if (lk > STUDY_MAX_LK) lk = STUDY_MAX_LK;
+		counts[(size_t)s * STUDY_NUM_BINS + lk + STUDY_MAX_LK]++;
+	}
+	return STUDY_TRUE;
+}
+
+/* Nearest point of the lattice of sites with x, y, z all even or all odd */
+static void __bcc_round(const double v[3], double out[3])
+{
+	double even[3], odd[3];
+	double d_even = 0.0, d_odd = 0.0;
+	for (int k = 0; k < 3; k++)
+	{
+		even[k] = 2.0 * round(v[k] / 2.0);
+		odd[k] = 2.0 * floor(v[k] / 2.0) + 1.0;
+		d_even += (v[k] - even[k]) * (v[k] - even[k]);
+		d_odd += (v[k] - odd[k]) * (v[k] - odd[k]);
+	}
+	memcpy(out, d_even <= d_odd ? even : odd, sizeof(even));
+}
+
+/* Move next_pair past pairs a resumed checkpoint already holds */
+static void __skip_analysed(struct study_job *job)
+{
+	while (job->next_pair < job->params->num_pairs
+		&& job->analysed[job->next_pair / 8] >> (job->next_pair % 8) & 1)
+	{
+		job->next_pair++;
+	}
+}
+
+/*
+ * Pool rings are chained through lat_key_hash site by site, so a pool that
+ * differs anywhere, or only in the order of its rings, hashes differently
+ */
+static uint64_t __pool_hash(const ChainPool *pool)
+{
+	uint64_t hash = (uint64_t)pool->N << 32 | (uint32_t)pool->num_rings;
+	for (size_t i = 0; i < (size_t)pool->num_rings * pool->N; i++)
+	{
+		hash = lat_key_hash(hash ^ lat_key_from_pt(&pool->rings[i]));
+	}
+	return hash;
+}
+
+/*
+ * Hand params->flush a copy of hist. Called with job->lock held: the rows
+ * are copied under it, then the lock is dropped while the callback writes
+ * them, so slow output stalls no other worker. Flushes never overlap, so
+ * they come out in order.
+ */
+static void __flush(struct study_job *job)
+{
+	job->flushing = true;
+	const StudyHist *hist = job->hist;
+	job->flush_hist.pairs = hist->pairs;
+	memcpy(job->flush_hist.counts, hist->counts, (size_t)hist->num_separations * STUDY_NUM_BINS * sizeof(long));
+	pthread_mutex_unlock(&job->lock);
+
+	job->params->flush(&job->flush_hist, job->params->flush_ctx);
+
+	pthread_mutex_lock(&job->lock);
+	job->flushing = false;
+}
+
+/*
+ * Write a checkpoint now, keeping the first error for study_run to return.
+ * Called with job->lock held: the histogram and bitmap are copied under it,
+ * then the lock is dropped while the copy is written and synced. One due
+ * while another worker is still writing is skipped; the next picks it up.
+ */
+static void __checkpoint(struct study_job *job)
+{
+	if (job->checkpointing) return;
+	job->checkpointing = true;
+	struct study_checkpoint ckpt;
+	__checkpoint_fill(job, &ckpt);
+	const StudyHist *hist = job->hist;
+	for (size_t i = 0; i < (size_t)hist->num_separations * STUDY_NUM_BINS; i++) job->ckpt_counts[i] = hist->counts[i];
+	memcpy(job->ckpt_analysed, job->analysed, (size_t)job->params->num_pairs / 8 + 1);
+	job->last_checkpoint = time(NULL);
+	pthread_mutex_unlock(&job->lock);
+
+	int status = __checkpoint_write(job, &ckpt);
+
+	pthread_mutex_lock(&job->lock);
+	job->checkpointing = false;
+	if (status != STUDY_TRUE && job->checkpoint_status == STUDY_TRUE) job->checkpoint_status = status;
+}
+
+/* Write ckpt and job's snapshot to a temporary file, sync it and rename it into place */
+static int __checkpoint_write(const struct study_job *job, const struct study_checkpoint *ckpt)
+{
+	const StudyParams *params = job->params;
+	const StudyHist *hist = job->hist;
+	size_t len = strlen(params->checkpoint);
+	char *tmp_path = (char *)malloc(len + sizeof(".tmp"));
+	if (tmp_path == NULL) return STUDY_MALLOC_ERROR;
+	memcpy(tmp_path, params->checkpoint, len);
+	memcpy(tmp_path + len, ".tmp", sizeof(".tmp"));
+
+	FILE *file = fopen(tmp_path, "wb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "%s() error: could not create %s.\n", __func__, tmp_path);
+		free(tmp_path);
+		return STUDY_IO_ERROR;
+	}
+	size_t num_counts = (size_t)hist->num_separations * STUDY_NUM_BINS;
+	size_t bitmap_len = (size_t)params->num_pairs / 8 + 1;
+	bool ok = fwrite(ckpt, sizeof(*ckpt), 1, file) == 1
+		&& fwrite(hist->separations, sizeof(double), hist->num_separations, file)
+			== (size_t)hist->num_separations
+		&& fwrite(job->ckpt_counts, sizeof(int64_t), num_counts, file) == num_counts
+		&& fwrite(job->ckpt_analysed, 1, bitmap_len, file) == bitmap_len;
+	ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+	ok = fclose(file) == 0 && ok;
+	ok = ok && rename(tmp_path, params->checkpoint) == 0;
+	if (!ok)
+	{
+		fprintf(stderr, "%s() error: could not write %s.\n", __func__, params->checkpoint);
+		remove(tmp_path);
+	}
+	free(tmp_path);
+	return ok ? STUDY_TRUE : STUDY_IO_ERROR;
+}
+
+/* Load the checkpoint into job->hist and job->analysed, if there is one */
+static int __checkpoint_read(struct study_job *job)
+{
+	const StudyParams *params = job->params;
+	StudyHist *hist = job->hist;
+	FILE *file = fopen(params->checkpoint, "rb");
+	if (file == NULL)
+	{
+		if (errno == ENOENT) return STUDY_TRUE; // a fresh run
+		fprintf(stderr, "%s() error: could not open %s.\n", __func__, params->checkpoint);
+		return STUDY_IO_ERROR;
+	}
+
+	struct study_checkpoint ckpt, expected;
+	__checkpoint_fill(job, &expected);
+	size_t num_counts = (size_t)hist->num_separations * STUDY_NUM_BINS;
+	size_t bitmap_len = (size_t)params->num_pairs / 8 + 1;
+	long *counts = (long *)malloc(num_counts * sizeof(long));
+	if (counts == NULL)
+	{
+		fclose(file);
+		return STUDY_MALLOC_ERROR;
+	}
+	int status = STUDY_TRUE;
+	if (fread(&ckpt, sizeof(ckpt), 1, file) != 1
+		|| memcmp(ckpt.magic, expected.magic, sizeof(ckpt.magic)) != 0
+		|| ckpt.version != expected.version || ckpt.N != expected.N
+		|| ckpt.num_pairs != expected.num_pairs || ckpt.seed != expected.seed
+		|| ckpt.num_separations != expected.num_separations
+		|| ckpt.pool_rings != expected.pool_rings || ckpt.pool_hash != expected.pool_hash)
+	{
+		status = STUDY_FORMAT_ERROR;
+	}
+	for (int s = 0; status == STUDY_TRUE && s < hist->num_separations; s++)
+	{
+		double sep;
+		if (fread(&sep, sizeof(sep), 1, file) != 1 || sep != hist->separations[s]) status = STUDY_FORMAT_ERROR;
+	}
+	for (size_t i = 0; status == STUDY_TRUE && i < num_counts; i++)
+	{
+		int64_t count;
+		if (fread(&count, sizeof(count), 1, file) != 1) status = STUDY_FORMAT_ERROR;
+		counts[i] = (long)count;
+	}
+	if (status == STUDY_TRUE && fread(job->analysed, 1, bitmap_len, file) != bitmap_len)
+	{
+		status = STUDY_FORMAT_ERROR;
+	}
+	int64_t analysed = 0;
+	for (int k = 0; status == STUDY_TRUE && k < params->num_pairs; k++)
+	{
+		analysed += job->analysed[k / 8] >> (k % 8) & 1;
+	}
+	if (status == STUDY_TRUE && analysed != ckpt.analysed) status = STUDY_FORMAT_ERROR;
+	fclose(file);
+
+	if (status == STUDY_TRUE)
+	{
+		memcpy(hist->counts, counts, num_counts * sizeof(long));
+		hist->pairs = (long)ckpt.pairs;
+		job->done_pairs = (int)ckpt.analysed;
+	}
+	else
+	{
+		memset(job->analysed, 0, bitmap_len);
+		fprintf(stderr, "%s() error: %s is not a checkpoint of this study.\n",
+			__func__, params->checkpoint);
+	}
+	free(counts);
+	return status;
+}
+
+/* The header of job's checkpoint as it stands */
+static void __checkpoint_fill(const struct study_job *job, struct study_checkpoint *ckpt)
+{
+	const StudyParams *params = job->params;
+	memset(ckpt, 0, sizeof(*ckpt));
+	memcpy(ckpt->magic, CHECKPOINT_MAGIC, sizeof(ckpt->magic));
+	ckpt->version = CHECKPOINT_VERSION;
+	ckpt->N = (uint32_t)params->N;
+	ckpt->num_pairs = (uint32_t)params->num_pairs;
+	ckpt->seed = params->seed;
+	ckpt->num_separations = (uint32_t)params->num_separations;
+	ckpt->pool_rings = params->pool ? (uint32_t)params->pool->num_rings : 0;
+	ckpt->pool_hash = job->pool_hash;
+	ckpt->pairs = job->hist->pairs;
+	for (int k = 0; k < params->num_pairs; k++) ckpt->analysed += job->analysed[k / 8] >> (k % 8) & 1;
+}
@@ -0,0 +1,122 @@
+#ifndef STUDY_H_
+#define STUDY_H_
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "chain.h"
+#include "pool.h"
+
+#define STUDY_TRUE 0
+#define STUDY_MALLOC_ERROR -2
+#define STUDY_INVALID_PARAMS -3
+#define STUDY_IO_ERROR -7
+#define STUDY_FORMAT_ERROR -8
+#define STUDY_LINK_ERROR -9
+
+#define STUDY_MAX_LK 8 /* linking numbers beyond +-STUDY_MAX_LK share the end bins */
+#define STUDY_NUM_BINS (2 * STUDY_MAX_LK + 1)
+
+/*
+ * Linking probability of pairs of closed rings against the distance between
+ * their centres of mass.
+ *
+ * Each pair is two rings of N monomers, generated once and then analysed at
+ * every separation: ring b is moved so its centre of mass sits at the given
+ * distance from ring a's, in a random direction, and the pair's linking
+ * number is counted with link_crossings_shifted. The rings avoid themselves
+ * but not each other; b is always moved by (1/2, 1/4, 0) off a's lattice, so
+ * they never touch and every placement has a linking number. Pair k draws
+ * its rings from streams
+ * 2k and 2k + 1 of ensemble_stream and its directions from a stream of its
+ * own, so the histograms do not depend on num_threads or on scheduling.
+ * With a pool the rings are instead both pool_draw copies from stream 2k,
+ * which trades independent rings for sampling at memory speed.
+ *
+ * Generating and analysing run as a pipeline: a bounded queue holds pairs
+ * waiting for analysis, and every worker analyses a waiting pair if there is
+ * one and otherwise generates the next, so both stages overlap and no thread
+ * idles while either has work.
+ *
+ * A run can checkpoint to a file and resume from it. Every random number of a
+ * pair comes from streams that start at counter 0 for that pair, so the
+ * state to save is just the set of pairs analysed and the histograms; pairs
+ * still in the pipeline are redone. Histograms are sums, so a resumed run
+ * ends with exactly the histograms of an uninterrupted one.
+ */
+typedef struct
+{
+	int num_separations;
+	double *separations;
+	long pairs;         /* pairs analysed at every separation */
+	long *counts;       /* counts[s * STUDY_NUM_BINS + lk + STUDY_MAX_LK] */
+} StudyHist, study_hist;
+
+/*
+ * Called with the histograms between pairs, outside the study's lock and
+ * never twice at once; must not keep hist
+ */
+typedef void (*study_flush_fn)(const StudyHist *hist, void *ctx);
+
+typedef struct
+{
+	int N;               /* monomers per ring */
+	int num_pairs;
+	const double *separations;
+	int num_separations;
+	int num_threads;     /* <= 0 means one thread */
+	int queue_len;       /* pairs that may wait for analysis; <= 0 means 2 per thread */
+	uint32_t seed;
+	const ChainPool *pool;           /* NULL to generate every ring */
+
+	study_flush_fn flush;            /* NULL for none */
+	void *flush_ctx;
+	long flush_every;                /* pairs between flushes; 0 means only on request */
+	volatile sig_atomic_t *flush_request; /* set (e.g. from a signal handler) for a flush */
+
+	const char *checkpoint;          /* NULL for none; resumed from if it exists */
+	int checkpoint_secs;             /* between checkpoints; <= 0 means only at the end */
+} StudyParams, study_params;
+
+int study_hist_init(StudyHist *hist, const double separations[], int num_separations);
+
+void study_hist_destroy(StudyHist *hist);
+
+/*  Run the study into hist, which must have been set up for the same
+    separations; counts are added to what hist already holds. flush is
+    called every flush_every pairs, whenever *flush_request is found set
+    (which clears it), and once at the end.
+
+    With a checkpoint file, a run first resumes from it if it exists,
+    replacing what hist holds with the saved histograms and skipping the
+    pairs already analysed. The file is then rewritten every
+    checkpoint_secs, on every flush, and at the end; each write goes to
+    a temporary file that is synced and renamed over it, so the file on disk
+    is always a complete checkpoint.
+
+    Returns:
+        STUDY_TRUE on success
+        STUDY_INVALID_PARAMS if N is odd or below 4, num_pairs is negative,
+            or the pool is empty or holds rings of other than N monomers
+        STUDY_MALLOC_ERROR if a worker could not allocate its buffers or grow
+            its occupancy bitmap
+        STUDY_FORMAT_ERROR if the checkpoint is corrupt or from another study
+        STUDY_LINK_ERROR if the linking number of some pair could not be
+            computed, e.g. because a pool ring has steps off the lattice
+        STUDY_IO_ERROR if the checkpoint could not be read, or a checkpoint
+            could not be written (the run itself still completes)
+*/
+int study_run(const StudyParams *params, StudyHist *hist,
+	Point3D dirs[], int dirs_len, int dim);
+
+/*
+ * Write hist as a table: one row per separation with the pairs placed, the
+ * linking probability and the histogram of linking numbers from
+ * -STUDY_MAX_LK to STUDY_MAX_LK.
+ */
+void study_hist_write(const StudyHist *hist, FILE *out);
+
+/* study_flush_fn writing study_hist_write to the FILE * in ctx and flushing it */
+void study_flush_fprint(const StudyHist *hist, void *ctx);
+
+#endif /* STUDY_H_ */
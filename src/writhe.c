@@ -0,0 +1,162 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "writhe.h"
+#include "solid_angle.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define TILE 512 /* segments per tile side */
+
+/* one upper-triangle tile of one chain */
+struct writhe_tile
+{
+	int chain;
+	int i0, j0;
+};
+
+/* state shared by every worker of one writhe_acn_ensemble call */
+struct writhe_job
+{
+	const Point3D *chains;
+	int N;
+	struct writhe_tile *tiles;
+	int num_tiles;
+	double *tile_sums;       /* sum and abs sum per tile */
+	int next_tile;           /* claimed with an atomic fetch-and-add */
+	int failures;            /* tiles left unsummed, counted the same way */
+	int status;
+};
+
+static void *__worker(void *arg);
+
+/*******************************************************************************
+                             FUNCTION DEFINITIONS
+*******************************************************************************/
+
+int writhe_acn(const Point3D chain[], int N, int num_threads,
+	double *wr, double *acn)
+{
+	return writhe_acn_ensemble(chain, N, 1, num_threads, wr, acn);
+}
+
+int writhe_acn_ensemble(const Point3D *chains, int N, int num_chains,
+	int num_threads, double *wr, double *acn)
+{
+	for (int k = 0; k < num_chains; k++)
+	{
+		if (wr) wr[k] = 0.0;
+		if (acn) acn[k] = 0.0;
+	}
+	if (N < 4 || num_chains <= 0) return WRITHE_TRUE;
+
+	int side = (N + TILE - 1) / TILE;
+	int tiles_per_chain = side * (side + 1) / 2;
+	struct writhe_job job = {
+		.chains    = chains,
+		.N         = N,
+		.num_tiles = tiles_per_chain * num_chains,
+		.next_tile = 0,
+		.failures  = 0,
+		.status    = WRITHE_TRUE
+	};
+	job.tiles = (struct writhe_tile *)malloc(job.num_tiles * sizeof(struct writhe_tile));
+	job.tile_sums = (double *)malloc(2 * (size_t)job.num_tiles * sizeof(double));
+	if (job.tiles == NULL || job.tile_sums == NULL)
+	{
+		job.status = WRITHE_MALLOC_ERROR;
+	}
+	else
+	{
+		int t = 0;
+		for (int k = 0; k < num_chains; k++)
+		{
+			for (int bi = 0; bi < side; bi++)
+			{
+				for (int bj = bi; bj < side; bj++)
+				{
+					job.tiles[t].chain = k;
+					job.tiles[t].i0 = bi * TILE;
+					job.tiles[t].j0 = bj * TILE;
+					t++;
+				}
+			}
+		}
+	}
+
+	if (num_threads > job.num_tiles) num_threads = job.num_tiles;
+	pthread_t *threads = NULL;
+	int started = 0;
+	if (job.status == WRITHE_TRUE && num_threads > 1)
+	{
+		threads = (pthread_t *)malloc((num_threads - 1) * sizeof(pthread_t));
+		for (; threads && started < num_threads - 1; started++)
+		{
+			if (pthread_create(&threads[started], NULL, __worker, &job) != 0) break;
+		}
+	}
+	if (job.status == WRITHE_TRUE)
+	{
+		// as in link_gauss, the caller works too and covers failed threads
+		__worker(&job);
+		for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+		// workers only count failures, so status is written here, after the join
+		if (job.next_tile < job.num_tiles || job.failures > 0) job.status = WRITHE_MALLOC_ERROR;
+	}
+	free(threads);
+
+	if (job.status == WRITHE_TRUE)
+	{
+		for (int t = 0; t < job.num_tiles; t++)
+		{
+			int k = job.tiles[t].chain;
+			if (wr) wr[k] += job.tile_sums[2 * t] / (2.0 * M_PI);
+			if (acn) acn[k] += job.tile_sums[2 * t + 1] / (2.0 * M_PI);
+		}
+	}
+	free(job.tiles);
+	free(job.tile_sums);
+	return job.status;
+}
+
+/*******************************************************************************
+        					    PRIVATE FUNCTIONS
+*******************************************************************************/
+
+static void *__worker(void *arg)
+{
+	struct writhe_job *job = (struct writhe_job *)arg;
+	int cols = job->N < TILE ? job->N : TILE;
+	double *work = (double *)malloc(solid_angle_work_len(cols) * sizeof(double));
+	if (work == NULL) return NULL;
+
+	// tiles of a chain are consecutive, so a worker rarely switches chains
+	SegArray segs = {NULL, NULL, NULL, 0};
+	int chain = -1;
+	for (;;)
+	{
+		int t = __sync_fetch_and_add(&job->next_tile, 1);
+		if (t >= job->num_tiles) break;
+		const struct writhe_tile *tile = &job->tiles[t];
+		if (tile->chain != chain)
+		{
+			seg_array_destroy(&segs);
+			chain = -1;
+			if (seg_array_init(&segs, job->chains + (size_t)tile->chain * job->N, job->N)
+				!= SOLID_ANGLE_TRUE)
+			{
+				__sync_fetch_and_add(&job->failures, 1);
+				continue;
+			}
+			chain = tile->chain;
+		}
+		int i1 = tile->i0 + TILE < job->N ? tile->i0 + TILE : job->N;
+		int j1 = tile->j0 + TILE < job->N ? tile->j0 + TILE : job->N;
+		solid_angle_block_self(&segs, tile->i0, i1, tile->j0, j1, work,
+			&job->tile_sums[2 * t], &job->tile_sums[2 * t + 1]);
+	}
+	seg_array_destroy(&segs);
+	free(work);
+	return NULL;
+}
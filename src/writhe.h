@@ -0,0 +1,43 @@
+#ifndef WRITHE_H_
+#define WRITHE_H_
+
+#include "point3d.h"
+
+#define WRITHE_TRUE 0
+#define WRITHE_MALLOC_ERROR -2
+
+/*
+ * Writhe and average crossing number of closed chains.
+ *
+ * Over the segment pairs i < j of one ring, with omega_ij the exact Gauss
+ * solid angle of solid_angle.h,
+ *
+ *     Wr  = (1 / 2 pi) sum omega_ij
+ *     ACN = (1 / 2 pi) sum |omega_ij|
+ *
+ * Only the upper triangle of pairs is visited, in square tiles spread over
+ * the threads; pairs of adjacent segments are skipped (their omega is 0).
+ * Tile sums are added in a fixed order, so results do not depend on the
+ * number of threads.
+ */
+
+/*  Writhe and ACN of the closed chain chain[0 .. N - 1]; num_threads <= 0
+    means one thread
+
+    Returns:
+        WRITHE_TRUE on success
+        WRITHE_MALLOC_ERROR if the chain or the workers' scratch could not be
+            allocated
+*/
+int writhe_acn(const Point3D chain[], int N, int num_threads,
+	double *wr, double *acn);
+
+/*  writhe_acn for num_chains chains of N monomers stored back to back, as from
+    ensemble_generate. Tiles of every chain share one pool of threads, so
+    short chains still keep all threads busy. wr and acn receive one value per
+    chain; either may be NULL.
+*/
+int writhe_acn_ensemble(const Point3D *chains, int N, int num_chains,
+	int num_threads, double *wr, double *acn);
+
+#endif /* WRITHE_H_ */
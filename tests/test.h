@@ -0,0 +1,26 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+
+/*
+ * Checks for the programs in tests/: each test_*.c is its own executable,
+ * built against every source but the GUI by `make test`. CHECK reports a
+ * failed condition with its location and carries on, so one run lists every
+ * failure; main returns TEST_STATUS.
+ */
+static int test_failures = 0;
+
+#define CHECK(cond) \
+	do \
+	{ \
+		if (!(cond)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			test_failures++; \
+		} \
+	} while (0)
+
+#define TEST_STATUS (test_failures == 0 ? 0 : 1)
+
+#endif /* TEST_H_ */
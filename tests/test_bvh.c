@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include "test.h"
+#include "ensemble.h"
+#include "bvh.h"
+#include "rng.h"
+
+#define DIM 3
+#define NUM_DIRS 8
+
+static Point3D dirs[NUM_DIRS];
+static RngStream rng;
+
+static double __uniform(double lo, double hi)
+{
+	return lo + (hi - lo) * (rng_u32(&rng) / 4294967296.0);
+}
+
+/* The smallest distance and the contact count over all segment pairs */
+static void __brute_force(const SegBvh *a, const SegBvh *b, double cutoff,
+	double *min_dist, long *contacts)
+{
+	double best = INFINITY;
+	long count = 0;
+	for (int i = 0; i < a->num_segments; i++)
+	{
+		for (int j = a == b ? i + 1 : 0; j < b->num_segments; j++)
+		{
+			// within one chain, segments sharing a vertex do not count
+			if (a == b && (j == i + 1 || (a->num_segments == a->N && i == 0 && j == a->N - 1))) continue;
+			const Point3D *p0, *p1, *q0, *q1;
+			bvh_segment(a, i, &p0, &p1);
+			bvh_segment(b, j, &q0, &q1);
+			double dist2 = seg_seg_dist2(p0, p1, q0, q1);
+			if (dist2 < best) best = dist2;
+			if (dist2 <= cutoff * cutoff) count++;
+		}
+	}
+	*min_dist = sqrt(best);
+	*contacts = count;
+}
+
+/* seg_seg_dist2 is the minimum over dense samples of both segments */
+static void __segment_distance(void)
+{
+	for (int t = 0; t < 200; t++)
+	{
+		Point3D p[4];
+		for (int k = 0; k < 4; k++)
+		{
+			p[k].x = (float)__uniform(-2, 2);
+			p[k].y = (float)__uniform(-2, 2);
+			p[k].z = (float)__uniform(-2, 2);
+		}
+		if (t % 4 == 0) p[3] = p[2]; // a segment of zero length
+		if (t % 4 == 1)
+		{
+			// parallel segments
+			p[3].x = p[2].x + (p[1].x - p[0].x);
+			p[3].y = p[2].y + (p[1].y - p[0].y);
+			p[3].z = p[2].z + (p[1].z - p[0].z);
+		}
+		double exact = seg_seg_dist2(&p[0], &p[1], &p[2], &p[3]);
+		double sampled = INFINITY;
+		for (int s = 0; s <= 200; s++)
+		{
+			for (int u = 0; u <= 200; u++)
+			{
+				double d[3] = {
+					p[0].x + (p[1].x - p[0].x) * s / 200.0 - p[2].x - (p[3].x - p[2].x) * u / 200.0,
+					p[0].y + (p[1].y - p[0].y) * s / 200.0 - p[2].y - (p[3].y - p[2].y) * u / 200.0,
+					p[0].z + (p[1].z - p[0].z) * s / 200.0 - p[2].z - (p[3].z - p[2].z) * u / 200.0
+				};
+				double dist2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+				if (dist2 < sampled) sampled = dist2;
+			}
+		}
+		CHECK(exact <= sampled + 1e-6);
+		CHECK(sqrt(sampled) - sqrt(exact) < 0.05);
+	}
+}
+
+/* Both kernels agree with the all-pairs loop, across chains and within one */
+static void __kernels(void)
+{
+	int N = 300, num_rings = 8;
+	Point3D *rings = (Point3D *)malloc((size_t)N * num_rings * sizeof(Point3D));
+	EnsembleParams params = {N, num_rings, 2, 23};
+	CHECK(ensemble_generate(rings, NULL, &params, dirs, NUM_DIRS, DIM) == ENS_TRUE);
+	for (int r = 1; r < num_rings; r++)
+	{
+		// move ring r off the lattice, near enough to tangle with ring 0
+		Point3D *ring = rings + (size_t)r * N;
+		float dx = (float)__uniform(-6, 6), dy = (float)__uniform(-6, 6), dz = (float)__uniform(-6, 6);
+		for (int i = 0; i < N; i++)
+		{
+			ring[i].x += dx;
+			ring[i].y += dy;
+			ring[i].z += dz;
+		}
+	}
+	for (int r = 1; r < num_rings; r++)
+	{
+		// open chains too, for the odd ring out
+		bool closed = r % 2 == 1;
+		SegBvh a, b;
+		CHECK(bvh_build(&a, rings, N, true) == BVH_TRUE);
+		CHECK(bvh_build(&b, rings + (size_t)r * N, N - r, closed) == BVH_TRUE);
+		double min_dist, cutoff;
+		long contacts;
+		__brute_force(&a, &b, 0.0, &min_dist, &contacts);
+		CHECK(fabs(bvh_min_distance(&a, &b) - min_dist) < 1e-9);
+		// past the closest pair, so some contacts are counted
+		cutoff = min_dist + 0.5 * r;
+		__brute_force(&a, &b, cutoff, &min_dist, &contacts);
+		CHECK(bvh_count_contacts(&a, &b, cutoff) == contacts);
+		CHECK(contacts > 0);
+		// non-adjacent bonds of one lattice chain are at least sqrt(2) apart
+		cutoff = 1.25 + 0.25 * r;
+		__brute_force(&b, &b, cutoff, &min_dist, &contacts);
+		CHECK(bvh_count_contacts(&b, &b, cutoff) == contacts);
+		CHECK(contacts > 0 || cutoff < sqrt(2.0));
+		bvh_destroy(&a);
+		bvh_destroy(&b);
+	}
+	free(rings);
+}
+
+struct query_ctx
+{
+	char *seen;
+	int visits;
+};
+
+static int __visit(int seg, void *ctx)
+{
+	struct query_ctx *qc = (struct query_ctx *)ctx;
+	qc->seen[seg] = 1;
+	qc->visits++;
+	return BVH_TRUE;
+}
+
+/* A query visits every segment whose own box meets the query box, once */
+static void __query(void)
+{
+	int N = 200;
+	Point3D *ring = (Point3D *)malloc(N * sizeof(Point3D));
+	EnsembleParams params = {N, 1, 1, 31};
+	CHECK(ensemble_generate(ring, NULL, &params, dirs, NUM_DIRS, DIM) == ENS_TRUE);
+	SegBvh bvh;
+	CHECK(bvh_build(&bvh, ring, N, true) == BVH_TRUE);
+	char *seen = (char *)malloc(N);
+	for (int t = 0; t < 100; t++)
+	{
+		float lo[3], hi[3];
+		for (int c = 0; c < 3; c++)
+		{
+			lo[c] = (float)__uniform(-8, 6);
+			hi[c] = lo[c] + (float)__uniform(0, 4);
+		}
+		for (int i = 0; i < N; i++) seen[i] = 0;
+		struct query_ctx qc = {seen, 0};
+		CHECK(bvh_query(&bvh, lo, hi, __visit, &qc) == BVH_TRUE);
+		int distinct = 0;
+		for (int i = 0; i < N; i++)
+		{
+			distinct += seen[i];
+			const Point3D *p0, *p1;
+			bvh_segment(&bvh, i, &p0, &p1);
+			float s_lo[3] = {fminf(p0->x, p1->x), fminf(p0->y, p1->y), fminf(p0->z, p1->z)};
+			float s_hi[3] = {fmaxf(p0->x, p1->x), fmaxf(p0->y, p1->y), fmaxf(p0->z, p1->z)};
+			bool meets = true;
+			for (int c = 0; c < 3; c++) meets = meets && s_lo[c] <= hi[c] && lo[c] <= s_hi[c];
+			if (meets) CHECK(seen[i]);
+		}
+		CHECK(distinct == qc.visits);
+	}
+	free(seen);
+	bvh_destroy(&bvh);
+	free(ring);
+}
+
+int main(void)
+{
+	gen_all_bin_list3(dirs, NUM_DIRS);
+	threefry2x32_ctr_t ctr = {{0, 0}};
+	threefry2x32_key_t key = {{12, 0}};
+	rng_init(&rng, ctr, key);
+	__segment_distance();
+	__kernels();
+	__query();
+	return TEST_STATUS;
+}
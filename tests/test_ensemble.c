@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "ensemble.h"
+
+#define DIM 3
+#define NUM_DIRS 8
+
+static Point3D dirs[NUM_DIRS];
+
+/* Chains are closed walks of lattice steps that visit no site twice */
+static void __check_chains(const Point3D *chains, int N, int num_chains)
+{
+	for (int k = 0; k < num_chains; k++)
+	{
+		Point3D *chain = (Point3D *)chains + (size_t)k * N;
+		CHECK(is_closed(chain, N));
+		for (int i = 0; i < N; i++)
+		{
+			const Point3D *a = &chain[i], *b = &chain[(i + 1) % N];
+			CHECK(fabsf(a->x - b->x) == 1.0f && fabsf(a->y - b->y) == 1.0f && fabsf(a->z - b->z) == 1.0f);
+			for (int j = 0; j < i; j++) CHECK(!pt_equal(&chain[i], &chain[j], EPS));
+		}
+	}
+}
+
+/* The same ensemble for any thread count */
+static void __thread_independence(void)
+{
+	int N = 60, num_chains = 40;
+	size_t size = (size_t)N * num_chains * sizeof(Point3D);
+	Point3D *one = (Point3D *)malloc(size), *many = (Point3D *)malloc(size);
+	int attempts_one[40], attempts_many[40];
+	EnsembleParams params = {N, num_chains, 1, 9};
+	CHECK(ensemble_generate(one, attempts_one, &params, dirs, NUM_DIRS, DIM) == ENS_TRUE);
+	params.num_threads = 4;
+	CHECK(ensemble_generate(many, attempts_many, &params, dirs, NUM_DIRS, DIM) == ENS_TRUE);
+	CHECK(memcmp(one, many, size) == 0);
+	CHECK(memcmp(attempts_one, attempts_many, sizeof(attempts_one)) == 0);
+	__check_chains(one, N, num_chains);
+	free(one);
+	free(many);
+}
+
+/* Every chain regenerates alone, from attempt 0 and from its last attempt */
+static void __regenerate(void)
+{
+	int N = 40, num_chains = 200;
+	Point3D *chains = (Point3D *)malloc((size_t)N * num_chains * sizeof(Point3D));
+	int *attempts = (int *)malloc(num_chains * sizeof(int));
+	EnsembleParams params = {N, num_chains, 3, 5};
+	CHECK(ensemble_generate(chains, attempts, &params, dirs, NUM_DIRS, DIM) == ENS_TRUE);
+	Point3D chain[40];
+	for (int k = 0; k < num_chains; k++)
+	{
+		const Point3D *want = chains + (size_t)k * N;
+		CHECK(regenerate_chain(chain, &params, k, 0, dirs, NUM_DIRS, DIM) == attempts[k]);
+		CHECK(memcmp(chain, want, sizeof(chain)) == 0);
+		CHECK(regenerate_chain(chain, &params, k, attempts[k] - 1, dirs, NUM_DIRS, DIM) == attempts[k]);
+		CHECK(memcmp(chain, want, sizeof(chain)) == 0);
+	}
+	free(chains);
+	free(attempts);
+}
+
+/* Walks that can never close are refused instead of retried forever */
+static void __invalid_params(void)
+{
+	Point3D chain[8];
+	EnsembleParams params = {7, 1, 1, 0};
+	CHECK(ensemble_generate(chain, NULL, &params, dirs, NUM_DIRS, DIM) == ENS_INVALID_PARAMS);
+	CHECK(regenerate_chain(chain, &params, 0, 0, dirs, NUM_DIRS, DIM) == ENS_INVALID_PARAMS);
+	params.N = 2;
+	CHECK(ensemble_generate(chain, NULL, &params, dirs, NUM_DIRS, DIM) == ENS_INVALID_PARAMS);
+	params.N = 8;
+	params.num_chains = -1;
+	CHECK(ensemble_generate(chain, NULL, &params, dirs, NUM_DIRS, DIM) == ENS_INVALID_PARAMS);
+}
+
+int main(void)
+{
+	gen_all_bin_list3(dirs, NUM_DIRS);
+	__thread_independence();
+	__regenerate();
+	__invalid_params();
+	return TEST_STATUS;
+}
@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include "test.h"
+#include "ensemble.h"
+#include "linking.h"
+#include "rng.h"
+
+#define DIM 3
+#define NUM_DIRS 8
+
+static Point3D dirs[NUM_DIRS];
+
+/*
+ * link_crossings_shifted against the rounded Gauss sum for random pairs of
+ * rings laid over each other, and link_crossings for the pairs that happen
+ * not to touch unshifted.
+ */
+static void __random_pairs(void)
+{
+	int N = 200, num_rings = 60, num_pairs = 1500;
+	Point3D *rings = (Point3D *)malloc((size_t)N * num_rings * sizeof(Point3D));
+	Point3D *moved = (Point3D *)malloc(N * sizeof(Point3D));
+	EnsembleParams params = {N, num_rings, 4, 17};
+	CHECK(ensemble_generate(rings, NULL, &params, dirs, NUM_DIRS, DIM) == ENS_TRUE);
+
+	threefry2x32_ctr_t ctr = {{0, 0}};
+	threefry2x32_key_t key = {{11, 0}};
+	RngStream rng;
+	rng_init(&rng, ctr, key);
+	int linked = 0, touching = 0;
+	for (int p = 0; p < num_pairs; p++)
+	{
+		const Point3D *a = rings + (size_t)rng_below(&rng, num_rings) * N;
+		const Point3D *b = rings + (size_t)rng_below(&rng, num_rings) * N;
+		// an integer offset of a few steps keeps the rings tangled; the
+		// fractional part keeps them apart
+		double shift[3] = {0.5, 0.25, 0.0};
+		for (int c = 0; c < 3; c++) shift[c] += (int)rng_below(&rng, 9) - 4;
+		for (int i = 0; i < N; i++)
+		{
+			moved[i].x = b[i].x + (float)shift[0];
+			moved[i].y = b[i].y + (float)shift[1];
+			moved[i].z = b[i].z + (float)shift[2];
+		}
+		int lk;
+		double gauss;
+		CHECK(link_crossings_shifted(a, N, b, N, shift, &lk) == LINK_TRUE);
+		CHECK(link_gauss(a, N, moved, N, 1, &gauss) == LINK_TRUE);
+		CHECK(lk == link_round(gauss));
+		CHECK(fabs(gauss - link_round(gauss)) < 1e-6);
+		linked += lk != 0;
+
+		// the same pair on the lattice itself, where it may touch
+		for (int i = 0; i < N; i++)
+		{
+			moved[i].x = b[i].x + (float)(shift[0] - 0.5);
+			moved[i].y = b[i].y + (float)(shift[1] - 0.25);
+			moved[i].z = b[i].z + (float)shift[2];
+		}
+		int status = link_crossings(a, N, moved, N, &lk);
+		CHECK(status == LINK_TRUE || status == LINK_INTERSECTING);
+		if (status == LINK_INTERSECTING)
+		{
+			touching++;
+			continue;
+		}
+		CHECK(link_gauss(a, N, moved, N, 1, &gauss) == LINK_TRUE);
+		CHECK(lk == link_round(gauss));
+	}
+	// both kinds of pair were seen, so neither check above was vacuous
+	CHECK(linked > 0);
+	CHECK(touching > 0 && touching < num_pairs);
+	free(rings);
+	free(moved);
+}
+
+/* A step longer than one site along some axis is refused */
+static void __invalid_chain(void)
+{
+	Point3D a[4] = {{0, 0, 0}, {1, 1, 1}, {2, 0, 0}, {1, -1, -1}};
+	Point3D b[4] = {{0, 0, 0}, {3, 1, 1}, {2, 0, 0}, {1, -1, -1}};
+	int lk;
+	CHECK(link_crossings(a, 4, b, 4, &lk) == LINK_INVALID_CHAIN);
+}
+
+int main(void)
+{
+	gen_all_bin_list3(dirs, NUM_DIRS);
+	__random_pairs();
+	__invalid_chain();
+	return TEST_STATUS;
+}
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "melt.h"
+
+#define DIM 3
+#define NUM_DIRS 8
+
+static Point3D dirs[NUM_DIRS];
+
+/* Site of p wrapped into [0, box)^3, as one index */
+static long __wrapped(const Point3D *p, int box)
+{
+	long c[3] = {lrintf(p->x) % box, lrintf(p->y) % box, lrintf(p->z) % box};
+	for (int k = 0; k < 3; k++) if (c[k] < 0) c[k] += box;
+	return (c[2] * box + c[1]) * box + c[0];
+}
+
+/*
+ * Rings are closed walks of lattice steps starting in the box, the cells
+ * hold exactly their sites, and no site is held twice across rings and
+ * images
+ */
+static void __check_melt(const Melt *melt)
+{
+	int N = melt->N, box = melt->box;
+	long num_cells = (long)box * box * box;
+	int *owner = (int *)calloc(num_cells, sizeof(int));
+	for (int k = 0; k < melt->num_chains; k++)
+	{
+		CHECK(melt->attempts[k] > 0);
+		const Point3D *ring = melt_ring(melt, k);
+		CHECK(ring[0].x >= 0 && ring[0].x < box && ring[0].y >= 0 && ring[0].y < box
+			&& ring[0].z >= 0 && ring[0].z < box);
+		for (int i = 0; i < N; i++)
+		{
+			const Point3D *p = &ring[i], *q = &ring[(i + 1) % N];
+			CHECK(fabsf(p->x - q->x) == 1.0f && fabsf(p->y - q->y) == 1.0f && fabsf(p->z - q->z) == 1.0f);
+			long site = __wrapped(p, box);
+			CHECK(owner[site] == 0);
+			owner[site] = k + 1;
+		}
+	}
+	for (long site = 0; site < num_cells; site++) CHECK(melt->cells[site] == (uint32_t)owner[site]);
+	free(owner);
+}
+
+/*
+ * Linking number of a with the images of b from the Gauss sum, over every
+ * image whose box meets a's and one more layer, which must all add 0. Sets
+ * *far_linked if some image other than the minimum one links a.
+ */
+static int __gauss_images(const Melt *melt, int a, int b, bool *far_linked)
+{
+	int N = melt->N, box = melt->box;
+	const Point3D *ring_a = melt_ring(melt, a), *ring_b = melt_ring(melt, b);
+	float lo_a[3], hi_a[3], lo_b[3], hi_b[3];
+	link_bounds(ring_a, N, lo_a, hi_a);
+	link_bounds(ring_b, N, lo_b, hi_b);
+	double com_a[3], com_b[3];
+	chain_centre(ring_a, N, com_a);
+	chain_centre(ring_b, N, com_b);
+	int first[3], last[3], nearest[3];
+	for (int c = 0; c < 3; c++)
+	{
+		first[c] = (int)floorf((lo_a[c] - hi_b[c]) / box) - 1;
+		last[c] = (int)ceilf((hi_a[c] - lo_b[c]) / box) + 1;
+		nearest[c] = (int)nearbyint((com_a[c] - com_b[c]) / box);
+	}
+	Point3D *image = (Point3D *)malloc(N * sizeof(Point3D));
+	int lk = 0;
+	for (int x = first[0]; x <= last[0]; x++)
+	{
+		for (int y = first[1]; y <= last[1]; y++)
+		{
+			for (int z = first[2]; z <= last[2]; z++)
+			{
+				for (int i = 0; i < N; i++)
+				{
+					image[i].x = ring_b[i].x + (float)(x * box);
+					image[i].y = ring_b[i].y + (float)(y * box);
+					image[i].z = ring_b[i].z + (float)(z * box);
+				}
+				double gauss;
+				CHECK(link_gauss(ring_a, N, image, N, 1, &gauss) == LINK_TRUE);
+				CHECK(fabs(gauss - link_round(gauss)) < 1e-6);
+				lk += link_round(gauss);
+				if (link_round(gauss) != 0 && (x != nearest[0] || y != nearest[1] || z != nearest[2]))
+				{
+					*far_linked = true;
+				}
+			}
+		}
+	}
+	free(image);
+	return lk;
+}
+
+/* melt_link against the Gauss sum over images, for every pair of rings */
+static void __links(const MeltParams *params, bool want_far_linked)
+{
+	Melt melt;
+	int status = melt_generate(&melt, params, dirs, NUM_DIRS, DIM);
+	CHECK(status == MELT_TRUE);
+	if (status != MELT_TRUE) return;
+	__check_melt(&melt);
+	bool far_linked = false;
+	for (int a = 0; a < melt.num_chains; a++)
+	{
+		for (int b = a + 1; b < melt.num_chains; b++)
+		{
+			int lk, lk_ba;
+			CHECK(melt_link(&melt, a, b, &lk) == LINK_TRUE);
+			CHECK(melt_link(&melt, b, a, &lk_ba) == LINK_TRUE);
+			CHECK(lk == lk_ba);
+			CHECK(lk == __gauss_images(&melt, a, b, &far_linked));
+		}
+	}
+	// rings spanning more than half the box link beyond the minimum image
+	if (want_far_linked) CHECK(far_linked);
+	melt_destroy(&melt);
+}
+
+/* One thread reproduces a melt from its seed */
+static void __reproducible(void)
+{
+	MeltParams params = {100, 30, 32, 1, 0, 8};
+	Melt one, two;
+	CHECK(melt_generate(&one, &params, dirs, NUM_DIRS, DIM) == MELT_TRUE);
+	CHECK(melt_generate(&two, &params, dirs, NUM_DIRS, DIM) == MELT_TRUE);
+	CHECK(memcmp(one.chains, two.chains, (size_t)params.N * params.num_chains * sizeof(Point3D)) == 0);
+	CHECK(memcmp(one.attempts, two.attempts, params.num_chains * sizeof(int)) == 0);
+	__check_melt(&one);
+	melt_destroy(&one);
+	melt_destroy(&two);
+
+	// several threads still give a valid melt
+	params.num_threads = 4;
+	CHECK(melt_generate(&one, &params, dirs, NUM_DIRS, DIM) == MELT_TRUE);
+	__check_melt(&one);
+	melt_destroy(&one);
+}
+
+static void __invalid_params(void)
+{
+	const MeltParams bad[] = {
+		{7, 2, 16, 1, 0, 0},     // odd N never closes
+		{2, 2, 16, 1, 0, 0},     // too short
+		{100, 2, 15, 1, 0, 0},   // odd box
+		{100, 200, 16, 1, 0, 0}, // past 1 / MELT_MAX_FILL of the sites
+		{100, -1, 16, 1, 0, 0}
+	};
+	for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+	{
+		Melt melt;
+		CHECK(melt_generate(&melt, &bad[i], dirs, NUM_DIRS, DIM) == MELT_INVALID_PARAMS);
+		melt_destroy(&melt);
+	}
+}
+
+int main(void)
+{
+	gen_all_bin_list3(dirs, NUM_DIRS);
+	MeltParams spanning = {300, 4, 24, 1, 0, 3};
+	__links(&spanning, true);
+	MeltParams dense = {60, 40, 32, 2, 0, 5};
+	__links(&dense, false);
+	__reproducible();
+	__invalid_params();
+	return TEST_STATUS;
+}
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include "test.h"
+#include "occ_bitmap.h"
+#include "rng.h"
+
+#define SIDE 80  /* the brute-force table covers [-SIDE / 2, SIDE / 2) cubed */
+#define REACH 36 /* walks stay within REACH of the origin, probes within 2 of them */
+
+static char table[SIDE][SIDE][SIDE];
+static RngStream rng;
+
+static char *__entry(const Point3D *pt)
+{
+	return &table[(int)pt->x + SIDE / 2][(int)pt->y + SIDE / 2][(int)pt->z + SIDE / 2];
+}
+
+/*
+ * Random walks of diagonal steps, with occasional jumps, against the table:
+ * every insert reports what the table says, and probes around the walk and
+ * far from it agree. Starting from room for one site makes the bitmap grow,
+ * and blocks four apart share a cache slot, which the jumps hit.
+ */
+static void __random_walks(void)
+{
+	OccBitmap bm;
+	CHECK(occ_bitmap_init(&bm, 1) == OCC_TRUE);
+	for (int walk = 0; walk < 20; walk++)
+	{
+		occ_bitmap_reset(&bm);
+		for (int x = 0; x < SIDE; x++)
+			for (int y = 0; y < SIDE; y++)
+				for (int z = 0; z < SIDE; z++) table[x][y][z] = 0;
+		uint64_t length = 0;
+		Point3D pt = {0, 0, 0};
+		for (int step = 0; step < 20000; step++)
+		{
+			if (rng_below(&rng, 100) == 0)
+			{
+				pt.x = (float)((int)rng_below(&rng, 2 * REACH + 1) - REACH);
+				pt.y = (float)((int)rng_below(&rng, 2 * REACH + 1) - REACH);
+				pt.z = (float)((int)rng_below(&rng, 2 * REACH + 1) - REACH);
+			}
+			else
+			{
+				uint32_t bits = rng_u32(&rng);
+				Point3D next = {pt.x + (bits & 1 ? 1 : -1), pt.y + (bits & 2 ? 1 : -1),
+					pt.z + (bits & 4 ? 1 : -1)};
+				if (fabsf(next.x) > REACH || fabsf(next.y) > REACH || fabsf(next.z) > REACH) continue;
+				pt = next;
+			}
+			char *entry = __entry(&pt);
+			int status = occ_bitmap_insert(&bm, &pt);
+			CHECK(status == (*entry ? OCC_ALREADY_PRESENT : OCC_TRUE));
+			length += !*entry;
+			*entry = 1;
+			CHECK(occ_bitmap_contains(&bm, &pt));
+
+			Point3D probe = {pt.x + (float)((int)rng_below(&rng, 5) - 2),
+				pt.y + (float)((int)rng_below(&rng, 5) - 2),
+				pt.z + (float)((int)rng_below(&rng, 5) - 2)};
+			CHECK(occ_bitmap_contains(&bm, &probe) == (*__entry(&probe) != 0));
+			probe.x = (float)((int)rng_below(&rng, SIDE) - SIDE / 2);
+			probe.y = (float)((int)rng_below(&rng, SIDE) - SIDE / 2);
+			probe.z = (float)((int)rng_below(&rng, SIDE) - SIDE / 2);
+			CHECK(occ_bitmap_contains(&bm, &probe) == (*__entry(&probe) != 0));
+		}
+		CHECK(occ_bitmap_length(&bm) == length);
+
+		// every site of the table, once the walk is done
+		for (int x = 0; x < SIDE; x++)
+		{
+			for (int y = 0; y < SIDE; y++)
+			{
+				for (int z = 0; z < SIDE; z++)
+				{
+					Point3D site = {x - SIDE / 2, y - SIDE / 2, z - SIDE / 2};
+					CHECK(occ_bitmap_contains(&bm, &site) == (table[x][y][z] != 0));
+				}
+			}
+		}
+	}
+	occ_bitmap_reset(&bm);
+	Point3D origin = {0, 0, 0};
+	CHECK(occ_bitmap_length(&bm) == 0 && !occ_bitmap_contains(&bm, &origin));
+	occ_bitmap_destroy(&bm);
+}
+
+/* Morton bits of one block are a permutation of [0, 512) */
+static void __morton(void)
+{
+	char seen[OCC_BLOCK_SIDE * OCC_BLOCK_SIDE * OCC_BLOCK_SIDE] = {0};
+	for (int x = -OCC_BLOCK_SIDE; x < 0; x++)
+	{
+		for (int y = 0; y < OCC_BLOCK_SIDE; y++)
+		{
+			for (int z = OCC_BLOCK_SIDE; z < 2 * OCC_BLOCK_SIDE; z++)
+			{
+				LatticePoint p = {x, y, z};
+				LatticePoint block = occ_bitmap_block_of(&p);
+				CHECK(block.x == -1 && block.y == 0 && block.z == 1);
+				unsigned bit = occ_bitmap_bit(&p);
+				CHECK(bit < sizeof(seen) && !seen[bit]);
+				if (bit < sizeof(seen)) seen[bit] = 1;
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	threefry2x32_ctr_t ctr = {{0, 0}};
+	threefry2x32_key_t key = {{25, 0}};
+	rng_init(&rng, ctr, key);
+	__morton();
+	__random_walks();
+	return TEST_STATUS;
+}
@@ -0,0 +1,80 @@
+#include "test.h"
+#include "rng.h"
+
+/*
+ * threefry2x32_batch against the Random123 known-answer vectors and against
+ * one threefry2x32 call per block, and RngStream's word order.
+ */
+
+struct kat
+{
+	uint32_t ctr[2], key[2], out[2];
+};
+
+static const struct kat kats[] = {
+	{{0x00000000, 0x00000000}, {0x00000000, 0x00000000}, {0x6b200159, 0x99ba4efe}},
+	{{0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}, {0x1cb996fc, 0xbb002be7}},
+	{{0x243f6a88, 0x85a308d3}, {0x13198a2e, 0x03707344}, {0xc4923a9c, 0x483df7a0}}
+};
+
+static void __known_answers(void)
+{
+	for (size_t i = 0; i < sizeof(kats) / sizeof(kats[0]); i++)
+	{
+		threefry2x32_ctr_t ctr = {{kats[i].ctr[0], kats[i].ctr[1]}};
+		threefry2x32_key_t key = {{kats[i].key[0], kats[i].key[1]}};
+		threefry2x32_ctr_t out = threefry2x32(ctr, key);
+		CHECK(out.v[0] == kats[i].out[0] && out.v[1] == kats[i].out[1]);
+		uint32_t batch[2];
+		threefry2x32_batch(key, ctr, 1, batch);
+		CHECK(batch[0] == kats[i].out[0] && batch[1] == kats[i].out[1]);
+	}
+}
+
+/* Every block count, so each vector width and the scalar tail are covered */
+static void __batch_matches_cipher(void)
+{
+	threefry2x32_key_t key = {{0x13198a2e, 0x03707344}};
+	for (int num_blocks = 1; num_blocks <= 2 * RNG_BLOCKS; num_blocks++)
+	{
+		// the first counters wrap v[0] past 2^32
+		threefry2x32_ctr_t first = {{0xfffffff0u + (uint32_t)num_blocks, 7}};
+		uint32_t out[4 * RNG_BLOCKS];
+		threefry2x32_batch(key, first, num_blocks, out);
+		for (int j = 0; j < num_blocks; j++)
+		{
+			threefry2x32_ctr_t ctr = {{first.v[0] + (uint32_t)j, first.v[1]}};
+			threefry2x32_ctr_t want = threefry2x32(ctr, key);
+			CHECK(out[2 * j] == want.v[0] && out[2 * j + 1] == want.v[1]);
+		}
+	}
+}
+
+/* Words 2j and 2j + 1 of a stream started at ctr are block ctr.v[0] + 1 + j */
+static void __stream_order(void)
+{
+	threefry2x32_ctr_t ctr = {{41, 3}};
+	threefry2x32_key_t key = {{5, 9}};
+	RngStream rng;
+	rng_init(&rng, ctr, key);
+	for (uint32_t j = 0; j < 3 * RNG_BLOCKS; j++)
+	{
+		threefry2x32_ctr_t block = {{ctr.v[0] + 1 + j, ctr.v[1]}};
+		threefry2x32_ctr_t want = threefry2x32(block, key);
+		uint32_t w0 = rng_u32(&rng), w1 = rng_u32(&rng);
+		CHECK(w0 == want.v[0] && w1 == want.v[1]);
+	}
+	for (int i = 0; i < 10000; i++)
+	{
+		uint32_t n = 1 + (uint32_t)i * 7919u;
+		CHECK(rng_below(&rng, n) < n);
+	}
+}
+
+int main(void)
+{
+	__known_answers();
+	__batch_matches_cipher();
+	__stream_order();
+	return TEST_STATUS;
+}
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "set.h"
+
+/*
+ * PointSet against a brute-force membership table over a small box of
+ * sites, through random add/remove/contains mixes and the set algebra, and
+ * PointBitset against the same table.
+ */
+
+#define SIDE 16 /* sites in [-SIDE / 2, SIDE / 2)^3 */
+#define NUM_SITES (SIDE * SIDE * SIDE)
+
+static Point3D __site(int index)
+{
+	Point3D pt = {
+		(float)(index % SIDE - SIDE / 2),
+		(float)(index / SIDE % SIDE - SIDE / 2),
+		(float)(index / SIDE / SIDE - SIDE / 2)
+	};
+	return pt;
+}
+
+/* every key in one probe run, so probing wraps and tombstones pile up */
+static uint64_t __degenerate_hash(const Point3D *key)
+{
+	(void)key;
+	return 0x5A;
+}
+
+static void __random_mix(set_hash_function hash, int num_ops)
+{
+	PointSet set;
+	CHECK(set_init_alt(&set, 16, hash) == SET_TRUE);
+	bool in[NUM_SITES] = {false};
+	uint64_t length = 0;
+	srand(7);
+	for (int op = 0; op < num_ops; op++)
+	{
+		int index = rand() % NUM_SITES;
+		Point3D key = __site(index);
+		switch (rand() % 3)
+		{
+		case 0:
+			CHECK(set_add(&set, &key) == (in[index] ? SET_ALREADY_PRESENT : SET_TRUE));
+			if (!in[index]) length++;
+			in[index] = true;
+			break;
+		case 1:
+			CHECK(set_remove(&set, &key) == (in[index] ? SET_TRUE : SET_FALSE));
+			if (in[index]) length--;
+			in[index] = false;
+			break;
+		default:
+			CHECK(set_contains(&set, &key) == (in[index] ? SET_TRUE : SET_FALSE));
+		}
+	}
+	CHECK(set_length(&set) == length);
+	for (int index = 0; index < NUM_SITES; index++)
+	{
+		Point3D key = __site(index);
+		CHECK(set_contains(&set, &key) == (in[index] ? SET_TRUE : SET_FALSE));
+	}
+	set_destroy(&set);
+}
+
+static void __negative_zero(void)
+{
+	PointSet set;
+	set_init(&set);
+	Point3D zero = {0.0f, 0.0f, 0.0f}, negative = {-0.0f, 0.0f, -0.0f};
+	CHECK(set_add(&set, &negative) == SET_TRUE);
+	CHECK(set_contains(&set, &zero) == SET_TRUE);
+	CHECK(set_add(&set, &zero) == SET_ALREADY_PRESENT);
+	CHECK(set_remove(&set, &zero) == SET_TRUE);
+	CHECK(set_length(&set) == 0);
+	set_destroy(&set);
+}
+
+/* Fill set and bits with a random half of the sites, recorded in in */
+static void __random_half(PointSet *set, PointBitset *bits, bool in[])
+{
+	for (int index = 0; index < NUM_SITES; index++)
+	{
+		in[index] = rand() % 2;
+		if (!in[index]) continue;
+		Point3D key = __site(index);
+		set_add(set, &key);
+		set_bitset_add(bits, &key);
+	}
+}
+
+static void __check_matches(PointSet *set, const PointBitset *bits, const bool in[])
+{
+	uint64_t length = 0;
+	for (int index = 0; index < NUM_SITES; index++)
+	{
+		Point3D key = __site(index);
+		CHECK(set_contains(set, &key) == (in[index] ? SET_TRUE : SET_FALSE));
+		CHECK(set_bitset_contains(bits, &key) == (in[index] ? SET_TRUE : SET_FALSE));
+		length += in[index];
+	}
+	CHECK(set_length(set) == length);
+	CHECK(set_bitset_length(bits) == length);
+}
+
+static void __algebra(void)
+{
+	LatticePoint min = {-SIDE / 2, -SIDE / 2, -SIDE / 2};
+	LatticePoint max = {SIDE / 2 - 1, SIDE / 2 - 1, SIDE / 2 - 1};
+	PointSet s1, s2, res;
+	PointBitset b1, b2, bres;
+	set_init(&s1);
+	set_init(&s2);
+	CHECK(set_bitset_init(&b1, &min, &max) == SET_TRUE);
+	CHECK(set_bitset_init(&b2, &min, &max) == SET_TRUE);
+	CHECK(set_bitset_init(&bres, &min, &max) == SET_TRUE);
+	static bool in1[NUM_SITES], in2[NUM_SITES], want[NUM_SITES];
+	srand(11);
+	__random_half(&s1, &b1, in1);
+	__random_half(&s2, &b2, in2);
+	__check_matches(&s1, &b1, in1);
+
+	for (int op = 0; op < 4; op++)
+	{
+		set_init(&res);
+		for (int index = 0; index < NUM_SITES; index++)
+		{
+			bool a = in1[index], b = in2[index];
+			want[index] = op == 0 ? a || b : op == 1 ? a && b : op == 2 ? a && !b : a != b;
+		}
+		switch (op)
+		{
+		case 0:
+			set_union(&res, &s1, &s2);
+			CHECK(set_bitset_union(&bres, &b1, &b2) == SET_TRUE);
+			break;
+		case 1:
+			set_intersection(&res, &s1, &s2);
+			CHECK(set_bitset_intersection(&bres, &b1, &b2) == SET_TRUE);
+			break;
+		case 2:
+			set_difference(&res, &s1, &s2);
+			CHECK(set_bitset_difference(&bres, &b1, &b2) == SET_TRUE);
+			break;
+		default:
+			set_symmetric_difference(&res, &s1, &s2);
+			CHECK(set_bitset_symmetric_difference(&bres, &b1, &b2) == SET_TRUE);
+		}
+		__check_matches(&res, &bres, want);
+		set_destroy(&res);
+	}
+
+	set_init(&res);
+	set_intersection(&res, &s1, &s2);
+	CHECK(set_is_subset(&res, &s1) == SET_TRUE);
+	CHECK(set_is_subset(&s1, &res) == SET_FALSE);
+	CHECK(set_bitset_intersection(&bres, &b1, &b2) == SET_TRUE);
+	CHECK(set_bitset_is_subset(&bres, &b1) == SET_TRUE);
+	CHECK(set_bitset_is_subset(&b1, &bres) == SET_FALSE);
+	CHECK(set_cmp(&s1, &s1) == SET_EQUAL);
+	set_destroy(&res);
+
+	// round trip through the other representation
+	set_init(&res);
+	CHECK(set_from_bitset(&res, &b1) == SET_TRUE);
+	CHECK(set_to_bitset(&bres, &s2) == SET_TRUE);
+	__check_matches(&res, &b1, in1);
+	__check_matches(&s2, &bres, in2);
+	set_destroy(&res);
+
+	// operands in different boxes are refused, and a key outside is not added
+	PointBitset other;
+	LatticePoint other_max = {SIDE / 2, SIDE / 2 - 1, SIDE / 2 - 1};
+	CHECK(set_bitset_init(&other, &min, &other_max) == SET_TRUE);
+	CHECK(set_bitset_union(&bres, &b1, &other) == SET_FALSE);
+	Point3D outside = {SIDE / 2, 0.0f, 0.0f};
+	CHECK(set_bitset_add(&b1, &outside) == SET_FALSE);
+	CHECK(set_bitset_add(&other, &outside) == SET_TRUE);
+
+	set_bitset_destroy(&other);
+	set_bitset_destroy(&b1);
+	set_bitset_destroy(&b2);
+	set_bitset_destroy(&bres);
+	set_destroy(&s1);
+	set_destroy(&s2);
+}
+
+int main(void)
+{
+	__random_mix(NULL, 200000);
+	__random_mix(__degenerate_hash, 20000);
+	__negative_zero();
+	__algebra();
+	return TEST_STATUS;
+}
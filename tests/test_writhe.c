@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include "test.h"
+#include "ensemble.h"
+#include "solid_angle.h"
+#include "writhe.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DIM 3
+#define NUM_DIRS 8
+
+static Point3D dirs[NUM_DIRS];
+
+/* Wr and ACN from solid_angle_pair over every pair i < j of segments */
+static void __brute_force(const Point3D chain[], int N, double *wr, double *acn)
+{
+	double sum = 0.0, abs_sum = 0.0;
+	for (int i = 0; i < N; i++)
+	{
+		for (int j = i + 2; j < N; j++)
+		{
+			if (i == 0 && j == N - 1) continue; // they share monomer 0
+			double omega = solid_angle_pair(&chain[i], &chain[i + 1],
+				&chain[j], &chain[(j + 1) % N]);
+			sum += omega;
+			abs_sum += fabs(omega);
+		}
+	}
+	*wr = sum / (2.0 * M_PI);
+	*acn = abs_sum / (2.0 * M_PI);
+}
+
+/*
+ * The tiled sums match the double loop, for chains of one tile and of
+ * several, whatever the thread count
+ */
+static void __matches_brute_force(void)
+{
+	const int lengths[] = {4, 100, 512, 1100};
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+	{
+		int N = lengths[l], num_chains = 3;
+		Point3D *chains = (Point3D *)malloc((size_t)N * num_chains * sizeof(Point3D));
+		EnsembleParams params = {N, num_chains, 2, 41 + (uint32_t)l};
+		CHECK(ensemble_generate(chains, NULL, &params, dirs, NUM_DIRS, DIM) == ENS_TRUE);
+		double wr[3], acn[3];
+		CHECK(writhe_acn_ensemble(chains, N, num_chains, 5, wr, acn) == WRITHE_TRUE);
+		for (int k = 0; k < num_chains; k++)
+		{
+			const Point3D *chain = chains + (size_t)k * N;
+			double want_wr, want_acn, one_wr, one_acn;
+			__brute_force(chain, N, &want_wr, &want_acn);
+			CHECK(fabs(wr[k] - want_wr) < 1e-10);
+			CHECK(fabs(acn[k] - want_acn) < 1e-10);
+			CHECK(acn[k] >= fabs(wr[k]));
+			// one chain alone, on one thread, sums its tiles in the same order
+			CHECK(writhe_acn(chain, N, 1, &one_wr, &one_acn) == WRITHE_TRUE);
+			CHECK(one_wr == wr[k] && one_acn == acn[k]);
+		}
+		free(chains);
+	}
+}
+
+int main(void)
+{
+	gen_all_bin_list3(dirs, NUM_DIRS);
+	__matches_brute_force();
+	return TEST_STATUS;
+}